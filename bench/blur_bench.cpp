@@ -0,0 +1,85 @@
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <fmt/core.h>
+#include <SDL3/SDL.h>
+#include "image.hpp"
+#include "blur.hpp"
+
+// Compares the blur kernels on card shadow masks at common screen sizes
+namespace {
+    constexpr int ITERATIONS = 50;
+    constexpr float CARD_WIDTH = 0.5f;
+    constexpr float CARD_SPACING = 0.011f;
+    constexpr int COLUMNS = 3;
+    constexpr float CARD_ASPECT_RATIO = 4.f / 3.f;
+
+    struct Resolution {
+        const char *name;
+        int w;
+    };
+
+    const char* kernels_name(BL::BlurKernels kernels)
+    {
+        switch (kernels) {
+            case BL::BlurKernels::SSE2:
+                return "SSE2";
+
+            case BL::BlurKernels::AVX2:
+                return "AVX2";
+
+            case BL::BlurKernels::NEON:
+                return "NEON";
+
+            default:
+                return "scalar";
+        }
+    }
+}
+
+int main(int, char**)
+{
+    std::mt19937 rng(0);
+    for (Resolution res : {Resolution{"1080p", 1920}, Resolution{"1440p", 2560}, Resolution{"4K", 3840}}) {
+        // Same card geometry and shadow parameters as the layout
+        float f_w = static_cast<float>(res.w);
+        float spacing = std::round(f_w * CARD_SPACING);
+        float card_w = (std::round(f_w * CARD_WIDTH) - (COLUMNS - 1) * spacing) / COLUMNS;
+        float card_h = std::round(card_w / CARD_ASPECT_RATIO);
+        float sigma = BL::SHADOW_BLUR_SLOPE * card_h + BL::SHADOW_BLUR_INTERCEPT;
+        int s_offset = static_cast<int>(std::round(sigma * 2.f));
+        int padding = 2 * static_cast<int>(std::ceil(sigma));
+        int w = static_cast<int>(card_w) + 2 * (s_offset + padding);
+        int h = static_cast<int>(card_h) + 2 * (s_offset + padding);
+
+        std::vector<Uint8> mask(w * h);
+        for (Uint8 &v : mask)
+            v = static_cast<Uint8>(rng());
+        std::vector<Uint8> buffer(w * h);
+        std::vector<Uint8> scratch(w * h);
+        std::vector<Uint8> reference;
+
+        fmt::print("{} ({}x{} mask, sigma {:.1f})\n", res.name, w, h, sigma);
+        for (BL::BlurKernels kernels : {BL::BlurKernels::SCALAR, BL::BlurKernels::SSE2, BL::BlurKernels::AVX2, BL::BlurKernels::NEON}) {
+            if (!BL::blur_kernels_supported(kernels))
+                continue;
+
+            double total = 0.0;
+            for (int i = 0; i < ITERATIONS; i++) {
+                buffer = mask;
+                auto start = std::chrono::steady_clock::now();
+                BL::blur_alpha(buffer.data(), scratch.data(), w, h, sigma, kernels);
+                total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            if (reference.empty())
+                reference = buffer;
+            fmt::print("  {:<8}{:8.3f} ms{}\n", 
+                kernels_name(kernels), 
+                total / ITERATIONS, 
+                buffer == reference ? "" : "  (output differs from scalar)"
+            );
+        }
+    }
+    return 0;
+}
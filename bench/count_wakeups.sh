@@ -0,0 +1,44 @@
+#!/bin/sh
+# Counts how often the threads of a running process were scheduled in over an interval, from the
+# context switch counters in /proc. A stand-in for powertop's wakeups per second when it isn't available
+#
+# Usage: count_wakeups.sh PID [SECONDS]
+
+pid="$1"
+seconds="${2:-10}"
+if [ -z "$pid" ] || [ ! -d "/proc/$pid" ]; then
+    echo "Usage: $0 PID [SECONDS]" >&2
+    exit 1
+fi
+
+# Prints "tid voluntary nonvoluntary" for every thread
+sample()
+{
+    for status in /proc/"$pid"/task/*/status; do
+        tid="${status%/status}"
+        tid="${tid##*/}"
+        awk -v tid="$tid" '/^voluntary_ctxt_switches/ { v = $2 } /^nonvoluntary_ctxt_switches/ { n = $2 }
+            END { if (v != "") print tid, v, n }' "$status" 2>/dev/null
+    done
+}
+
+before=$(sample)
+sleep "$seconds"
+after=$(sample)
+
+printf '%s\n' "$before" | awk -v seconds="$seconds" -v after="$after" '
+    BEGIN {
+        n = split(after, lines, "\n")
+        for (i = 1; i <= n; i++) {
+            split(lines[i], f, " ")
+            av[f[1]] = f[2]
+            an[f[1]] = f[3]
+        }
+    }
+    $1 in av {
+        v = av[$1] - $2
+        nv = an[$1] - $3
+        printf "thread %-8s %8d voluntary %8d involuntary\n", $1, v, nv
+        total += v + nv
+    }
+    END { printf "total %d wakeups in %d s, %.1f per second\n", total, seconds, total / seconds }'
@@ -0,0 +1,343 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <exception>
+#include <getopt.h>
+#include <cstdlib>
+#include <fmt/core.h>
+#include "logger.hpp"
+
+#include <SDL3/SDL.h>
+
+#include <lconfig.h>
+#include "main.hpp"
+#include "config.hpp"
+#include "profiler.hpp"
+#include "frame_stats.hpp"
+#include "alloc_counter.hpp"
+#include "util.hpp"
+
+// Drives the launcher headless with the software renderer and reports frame time percentiles
+BL::Config config;
+BL::Profiler profiler;
+BL::FrameStats frame_stats;
+const char *executable_dir = SDL_GetBasePath();
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    constexpr int DEFAULT_FRAMES = 2000;
+    constexpr int DEFAULT_STEP_FRAMES = 20;
+    constexpr const char *DEFAULT_SCRIPT = "right,down,down,right,up,left,down,right,right,select,left,up,up";
+
+    struct Options {
+        std::string config_path;
+        std::string layout_path;
+        std::string script = DEFAULT_SCRIPT;
+        int frames = DEFAULT_FRAMES;
+        int step_frames = DEFAULT_STEP_FRAMES;
+        bool check_allocations = false;
+    };
+
+    // Virtual gamepad input for the allocation check, each step holds a button and then waits
+    struct Step {
+        const char *name;
+        SDL_GamepadButton button; // SDL_GAMEPAD_BUTTON_INVALID only waits
+        Uint64 hold_ms;
+        Uint64 wait_ms;
+    };
+    constexpr Uint32 SCENARIO_IDLE_TIME = 1000; // ms until the screensaver starts fading in
+    constexpr Step SCENARIO[] = {
+        {"enter menu",    SDL_GAMEPAD_BUTTON_DPAD_RIGHT, 100,  300},
+        {"repeat down",   SDL_GAMEPAD_BUTTON_DPAD_DOWN,  1500, 300},
+        {"repeat up",     SDL_GAMEPAD_BUTTON_DPAD_UP,    1500, 300},
+        {"press",         SDL_GAMEPAD_BUTTON_SOUTH,      100,  400},
+        {"leave menu",    SDL_GAMEPAD_BUTTON_DPAD_LEFT,  100,  300},
+        {"next menu",     SDL_GAMEPAD_BUTTON_DPAD_DOWN,  100,  300},
+        {"previous menu", SDL_GAMEPAD_BUTTON_DPAD_UP,    100,  300},
+        {"screensaver",   SDL_GAMEPAD_BUTTON_INVALID,    0,    SCENARIO_IDLE_TIME + 2500},
+        {"wake down",     SDL_GAMEPAD_BUTTON_DPAD_DOWN,  100,  300},
+        {"wake up",       SDL_GAMEPAD_BUTTON_DPAD_UP,    100,  300}
+    };
+    constexpr size_t SCENARIO_STEPS = sizeof(SCENARIO) / sizeof(SCENARIO[0]);
+
+    struct Samples {
+        const char *name;
+        std::vector<double> ms;
+
+        double percentile(double p)
+        {
+            std::sort(ms.begin(), ms.end());
+            size_t i = static_cast<size_t>(std::ceil(p * static_cast<double>(ms.size())));
+            return ms[std::clamp<size_t>(i, 1, ms.size()) - 1];
+        }
+    };
+
+    double elapsed_ms(Clock::time_point begin)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    }
+
+    void print_help()
+    {
+        fmt::print("Usage: big-launcher-bench [OPTIONS]\n");
+        fmt::print("    -c p,  --config=p     Load config file from path p.\n");
+        fmt::print("    -l p,  --layout=p     Load layout file from path p.\n");
+        fmt::print("    -n N,  --frames=N     Number of timed frames (default {}).\n", DEFAULT_FRAMES);
+        fmt::print("    -s N,  --step=N       Frames between scripted moves (default {}).\n", DEFAULT_STEP_FRAMES);
+        fmt::print("    -S s,  --script=s     Comma separated moves out of up, down, left, right and select.\n");
+        fmt::print("    -a,    --check-allocations\n");
+        fmt::print("                          Replay a gamepad scenario twice and fail if the second run\n");
+        fmt::print("                          allocates (needs a build with COUNT_ALLOCATIONS).\n");
+        fmt::print("    -d,    --debug        Enable debug messages.\n");
+        fmt::print("    -h,    --help         Show this help message.\n");
+    }
+
+    Options parse_command_line(int argc, char *argv[])
+    {
+        Options options;
+        int c;
+        static struct option long_opts[] = {
+            { "config",  required_argument, nullptr, 'c' },
+            { "layout",  required_argument, nullptr, 'l' },
+            { "frames",  required_argument, nullptr, 'n' },
+            { "step",    required_argument, nullptr, 's' },
+            { "script",  required_argument, nullptr, 'S' },
+            { "check-allocations", no_argument, nullptr, 'a' },
+            { "debug",   no_argument,       nullptr, 'd' },
+            { "help",    no_argument,       nullptr, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        while ((c = getopt_long(argc, argv, "c:l:n:s:S:adh", long_opts, nullptr)) != -1) {
+            switch (c) {
+                case 'c':
+                    options.config_path = optarg;
+                    break;
+
+                case 'l':
+                    options.layout_path = optarg;
+                    break;
+
+                case 'n':
+                    options.frames = std::max(std::atoi(optarg), 1);
+                    break;
+
+                case 's':
+                    options.step_frames = std::max(std::atoi(optarg), 1);
+                    break;
+
+                case 'S':
+                    options.script = optarg;
+                    break;
+
+                case 'a':
+                    options.check_allocations = true;
+                    break;
+
+                case 'd':
+                    config.debug = true;
+                    break;
+
+                case 'h':
+                    print_help();
+                    exit(EXIT_SUCCESS);
+                    break;
+
+                default:
+                    print_help();
+                    exit(EXIT_FAILURE);
+            }
+        }
+        return options;
+    }
+
+    // Turns "down,right,select" into launcher commands
+    std::vector<std::string> parse_script(const std::string &script)
+    {
+        std::vector<std::string> commands;
+        size_t begin = 0;
+        while (begin <= script.size()) {
+            size_t end = script.find(',', begin);
+            if (end == std::string::npos)
+                end = script.size();
+            std::string move = script.substr(begin, end - begin);
+            if (move != "up" && move != "down" && move != "left" && move != "right" && move != "select")
+                throw std::runtime_error(fmt::format("Invalid move '{}' in script", move));
+            commands.push_back(":" + move);
+            begin = end + 1;
+        }
+        return commands;
+    }
+
+    // Runs at least one frame, so a zero duration still pumps the launcher once
+    void run_frames(BL::Launcher &launcher, Uint64 ms)
+    {
+        Uint64 end = SDL_GetTicks() + ms;
+        do {
+            launcher.update();
+            launcher.process_events();
+            launcher.draw();
+            launcher.present();
+            frame_stats.end_frame();
+        } while (SDL_GetTicks() < end);
+    }
+
+    // Returns the allocations made during every step
+    std::array<Uint64, SCENARIO_STEPS> run_scenario(BL::Launcher &launcher, SDL_Joystick &joystick)
+    {
+        std::array<Uint64, SCENARIO_STEPS> allocations{};
+        for (size_t i = 0; i < SCENARIO_STEPS; i++) {
+            const Step &step = SCENARIO[i];
+            Uint64 begin = BL::allocation_count();
+            if (step.button != SDL_GAMEPAD_BUTTON_INVALID) {
+                SDL_SetJoystickVirtualButton(&joystick, step.button, true);
+                run_frames(launcher, step.hold_ms);
+                SDL_SetJoystickVirtualButton(&joystick, step.button, false);
+            }
+            run_frames(launcher, step.wait_ms);
+            allocations[i] = BL::allocation_count() - begin;
+        }
+        return allocations;
+    }
+
+    // Shifts, presses, gamepad repeat, sidebar colour changes and the screensaver fade are driven
+    // through a virtual gamepad. The first run warms up caches and buffers, the second must not allocate
+    int check_allocations(const Options &options)
+    {
+#ifndef COUNT_ALLOCATIONS
+        fmt::print(stderr, "The allocation check needs a build configured with -DCOUNT_ALLOCATIONS=ON\n");
+        return EXIT_FAILURE;
+#else
+        config.gamepad_enabled = true;
+        config.gamepad_controls.clear();
+        config.gamepad_controls.emplace_back(BL::GamepadControl::Type::BUTTON, SDL_GAMEPAD_BUTTON_DPAD_LEFT, BL::GamepadControl::Direction::NONE, "ButtonDPadLeft", ":left");
+        config.gamepad_controls.emplace_back(BL::GamepadControl::Type::BUTTON, SDL_GAMEPAD_BUTTON_DPAD_RIGHT, BL::GamepadControl::Direction::NONE, "ButtonDPadRight", ":right");
+        config.gamepad_controls.emplace_back(BL::GamepadControl::Type::BUTTON, SDL_GAMEPAD_BUTTON_DPAD_UP, BL::GamepadControl::Direction::NONE, "ButtonDPadUp", ":up");
+        config.gamepad_controls.emplace_back(BL::GamepadControl::Type::BUTTON, SDL_GAMEPAD_BUTTON_DPAD_DOWN, BL::GamepadControl::Direction::NONE, "ButtonDPadDown", ":down");
+        config.gamepad_controls.emplace_back(BL::GamepadControl::Type::BUTTON, SDL_GAMEPAD_BUTTON_SOUTH, BL::GamepadControl::Direction::NONE, "ButtonA", ":select");
+        config.screensaver_enabled = true;
+        config.screensaver_idle_time = SCENARIO_IDLE_TIME;
+
+        BL::Launcher launcher(options.layout_path);
+        launcher.set_dry_run(true);
+        SDL_VirtualJoystickDesc desc;
+        SDL_INIT_INTERFACE(&desc);
+        desc.type = SDL_JOYSTICK_TYPE_GAMEPAD;
+        desc.naxes = SDL_GAMEPAD_AXIS_COUNT;
+        desc.nbuttons = SDL_GAMEPAD_BUTTON_COUNT;
+        desc.name = "big-launcher-bench virtual gamepad";
+        SDL_JoystickID id = SDL_AttachVirtualJoystick(&desc);
+        SDL_Joystick *joystick = id ? SDL_OpenJoystick(id) : nullptr;
+        if (!joystick) {
+            fmt::print(stderr, "Could not create virtual gamepad (SDL Error: {})\n", SDL_GetError());
+            return EXIT_FAILURE;
+        }
+        while (launcher.is_loading())
+            run_frames(launcher, 0);
+
+        run_scenario(launcher, *joystick);
+        Uint64 warm_frames = frame_stats.get_allocating_frames();
+        std::array<Uint64, SCENARIO_STEPS> allocations = run_scenario(launcher, *joystick);
+        SDL_CloseJoystick(joystick);
+        SDL_DetachVirtualJoystick(id);
+
+        frame_stats.print_allocation_histogram();
+        Uint64 total = 0;
+        for (size_t i = 0; i < SCENARIO_STEPS; i++) {
+            fmt::print("  {:<14}{:>8} allocations\n", SCENARIO[i].name, allocations[i]);
+            total += allocations[i];
+        }
+        fmt::print("{} allocating frames during warm-up, {} allocations after warm-up\n", warm_frames, total);
+        return total ? EXIT_FAILURE : EXIT_SUCCESS;
+#endif
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try {
+        Options options = parse_command_line(argc, argv);
+        std::vector<std::string> script = parse_script(options.script);
+        spdlog::set_level(config.debug ? spdlog::level::debug : spdlog::level::warn);
+
+        if (options.layout_path.empty())
+            options.layout_path = BL::find_file<BL::FileType::CONFIG>(LAYOUT_FILENAME);
+        if (options.layout_path.empty())
+            BL::logger::critical("Could not locate layout file");
+        if (options.config_path.empty())
+            options.config_path = BL::find_file<BL::FileType::CONFIG>(CONFIG_FILENAME);
+        if (!options.config_path.empty())
+            config.parse(options.config_path);
+
+        // Nothing but the layout and the renderer should be measured
+        config.sound_enabled = false;
+        config.gamepad_enabled = false;
+        config.screensaver_enabled = false;
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        if (options.check_allocations)
+            return check_allocations(options);
+
+        auto start = Clock::now();
+        BL::Launcher launcher(options.layout_path);
+        launcher.set_dry_run(true);
+        double startup_ms = elapsed_ms(start);
+
+        // Untimed frames until every menu has its cards
+        launcher.update();
+        launcher.draw();
+        launcher.present();
+        double first_frame_ms = elapsed_ms(start);
+        while (launcher.is_loading()) {
+            launcher.update();
+            launcher.draw();
+            launcher.present();
+        }
+        double loaded_ms = elapsed_ms(start);
+
+        Samples update{"update"}, draw{"draw"}, present{"present"}, frame{"frame"};
+        for (Samples *samples : {&update, &draw, &present, &frame})
+            samples->ms.reserve(options.frames);
+        size_t step = 0;
+        for (int i = 0; i < options.frames; i++) {
+            if (i % options.step_frames == 0)
+                launcher.execute_command(script[step++ % script.size()]);
+
+            auto begin = Clock::now();
+            launcher.update();
+            auto updated = Clock::now();
+            launcher.draw();
+            auto drawn = Clock::now();
+            launcher.present();
+            auto presented = Clock::now();
+            frame_stats.end_frame();
+            update.ms.push_back(std::chrono::duration<double, std::milli>(updated - begin).count());
+            draw.ms.push_back(std::chrono::duration<double, std::milli>(drawn - updated).count());
+            present.ms.push_back(std::chrono::duration<double, std::milli>(presented - drawn).count());
+            frame.ms.push_back(std::chrono::duration<double, std::milli>(presented - begin).count());
+        }
+
+        fmt::print("Video driver: {}\n", SDL_GetCurrentVideoDriver());
+        fmt::print("Startup:      {:8.2f} ms\n", startup_ms);
+        fmt::print("First frame:  {:8.2f} ms\n", first_frame_ms);
+        fmt::print("Loaded:       {:8.2f} ms\n", loaded_ms);
+        fmt::print("\n{} frames, {} moves, {} draw calls in the last frame, {} live textures\n",
+            options.frames, step, frame_stats.get_draw_calls(), frame_stats.get_live_textures());
+        fmt::print("  {:<10}{:>10}{:>10}{:>10}\n", "", "p50", "p95", "p99");
+        for (Samples *samples : {&update, &draw, &present, &frame}) {
+            fmt::print("  {:<10}{:7.3f} ms{:7.3f} ms{:7.3f} ms\n",
+                samples->name,
+                samples->percentile(0.50),
+                samples->percentile(0.95),
+                samples->percentile(0.99)
+            );
+        }
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception &e) {
+        fmt::print(stderr, "Benchmark failed: {}\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,395 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <exception>
+#include <getopt.h>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+
+// Writes a layout.xml with the given number of entries plus deterministic procedural SVG/PNG assets
+namespace {
+    constexpr int DEFAULT_ENTRIES = 100;
+    constexpr int ENTRIES_PER_MENU = 12;
+    constexpr int MAX_MENUS = 40;
+    constexpr int MIN_POOL = 4;
+    constexpr int MAX_POOL = 64;
+    constexpr int CARD_W = 800;
+    constexpr int CARD_H = 600;
+
+    struct Options {
+        std::filesystem::path dir = "layout-gen";
+        int entries = DEFAULT_ENTRIES;
+        int menus = 0;
+        Uint32 seed = 1;
+        bool edge_cases = true;
+    };
+
+    // Every way an entry's card can be specified, see Menu::add_entry() and MenuEntry::render_surface()
+    enum class CardKind {
+        CUSTOM_SVG,
+        CUSTOM_PNG,
+        SVG_ICON_COLOR,
+        PNG_ICON_COLOR,
+        SVG_ICON_PNG_BACKGROUND,
+        PNG_ICON_SVG_BACKGROUND,
+        ICON_ONLY,
+        COUNT
+    };
+
+    // std::uniform_int_distribution differs between standard libraries, plain modulo keeps the output identical everywhere
+    class Random {
+    private:
+        std::mt19937 rng;
+
+    public:
+        Random(Uint32 seed): rng(seed) {}
+        int next(int n) { return static_cast<int>(rng() % static_cast<Uint32>(n)); }
+        Uint8 byte() { return static_cast<Uint8>(rng() & 0xFF); }
+        std::string color()
+        {
+            // Function arguments are evaluated in an unspecified order, so every draw gets its own statement
+            Uint8 r = byte();
+            Uint8 g = byte();
+            Uint8 b = byte();
+            return fmt::format("#{:02X}{:02X}{:02X}", r, g, b);
+        }
+    };
+
+    struct AssetPool {
+        std::vector<std::string> svg_icons;
+        std::vector<std::string> png_icons;
+        std::vector<std::string> svg_backgrounds;
+        std::vector<std::string> png_backgrounds;
+        std::vector<std::string> svg_cards;
+        std::vector<std::string> png_cards;
+    };
+
+    void print_help()
+    {
+        fmt::print("Usage: layout-gen [OPTIONS]\n");
+        fmt::print("    -o d,  --output=d     Write layout.xml and assets to directory d (default layout-gen).\n");
+        fmt::print("    -n N,  --entries=N    Number of menu entries (default {}).\n", DEFAULT_ENTRIES);
+        fmt::print("    -m N,  --menus=N      Number of menus (default: {} entries per menu, at most {} menus).\n", ENTRIES_PER_MENU, MAX_MENUS);
+        fmt::print("    -s N,  --seed=N       Random seed (default 1).\n");
+        fmt::print("    -e,    --no-edge-cases  Leave out the menu of malformed entries.\n");
+        fmt::print("    -h,    --help         Show this help message.\n");
+    }
+
+    Options parse_command_line(int argc, char *argv[])
+    {
+        Options options;
+        int c;
+        static struct option long_opts[] = {
+            { "output",        required_argument, nullptr, 'o' },
+            { "entries",       required_argument, nullptr, 'n' },
+            { "menus",         required_argument, nullptr, 'm' },
+            { "seed",          required_argument, nullptr, 's' },
+            { "no-edge-cases", no_argument,       nullptr, 'e' },
+            { "help",          no_argument,       nullptr, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        while ((c = getopt_long(argc, argv, "o:n:m:s:eh", long_opts, nullptr)) != -1) {
+            switch (c) {
+                case 'o':
+                    options.dir = optarg;
+                    break;
+
+                case 'n':
+                    options.entries = std::max(std::atoi(optarg), 1);
+                    break;
+
+                case 'm':
+                    options.menus = std::max(std::atoi(optarg), 1);
+                    break;
+
+                case 's':
+                    options.seed = static_cast<Uint32>(std::strtoul(optarg, nullptr, 10));
+                    break;
+
+                case 'e':
+                    options.edge_cases = false;
+                    break;
+
+                case 'h':
+                    print_help();
+                    exit(EXIT_SUCCESS);
+                    break;
+
+                default:
+                    print_help();
+                    exit(EXIT_FAILURE);
+            }
+        }
+        if (!options.menus)
+            options.menus = std::clamp((options.entries + ENTRIES_PER_MENU - 1) / ENTRIES_PER_MENU, 1, MAX_MENUS);
+        options.menus = std::min(options.menus, options.entries);
+        return options;
+    }
+
+    void write_file(const std::filesystem::path &path, const std::string &content)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+        if (!file)
+            throw std::runtime_error(fmt::format("Could not write '{}'", path.string()));
+    }
+
+    // Random shapes inside a w x h view box, wide, square and tall icons take different branches when scaled
+    std::string svg_icon(Random &random)
+    {
+        constexpr int SIZES[][2] = {{256, 256}, {512, 128}, {128, 320}, {400, 200}};
+        auto [w, h] = SIZES[random.next(4)];
+        std::string svg = fmt::format("<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"{0}\" height=\"{1}\" viewBox=\"0 0 {0} {1}\">\n", w, h);
+        int shapes = 3 + random.next(6);
+        for (int i = 0; i < shapes; i++) {
+            int x = random.next(w);
+            int y = random.next(h);
+            int r = 8 + random.next(std::min(w, h) / 3);
+            switch (random.next(3)) {
+                case 0:
+                    svg += fmt::format("  <circle cx=\"{}\" cy=\"{}\" r=\"{}\" fill=\"{}\"/>\n", x, y, r, random.color());
+                    break;
+
+                case 1:
+                    svg += fmt::format("  <rect x=\"{}\" y=\"{}\" width=\"{}\" height=\"{}\" rx=\"{}\" fill=\"{}\" fill-opacity=\"0.8\"/>\n",
+                        x / 2, y / 2, r * 2, r, r / 4, random.color());
+                    break;
+
+                default:
+                    int x1 = random.next(w);
+                    int y1 = random.next(h);
+                    int x2 = random.next(w);
+                    int y2 = random.next(h);
+                    std::string fill = random.color();
+                    std::string stroke = random.color();
+                    svg += fmt::format("  <path d=\"M {} {} L {} {} L {} {} Z\" fill=\"{}\" stroke=\"{}\" stroke-width=\"4\"/>\n",
+                        x, y, x1, y1, x2, y2, fill, stroke);
+            }
+        }
+        return svg + "</svg>\n";
+    }
+
+    // Full bleed gradient with a few translucent shapes, used for backgrounds and custom cards
+    std::string svg_background(Random &random, int w, int h)
+    {
+        std::string svg = fmt::format("<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"{0}\" height=\"{1}\" viewBox=\"0 0 {0} {1}\">\n", w, h);
+        std::string from = random.color();
+        std::string to = random.color();
+        svg += fmt::format("  <defs><linearGradient id=\"g\" x1=\"0\" y1=\"0\" x2=\"1\" y2=\"1\"><stop offset=\"0\" stop-color=\"{}\"/><stop offset=\"1\" stop-color=\"{}\"/></linearGradient></defs>\n",
+            from, to);
+        svg += fmt::format("  <rect width=\"{}\" height=\"{}\" fill=\"url(#g)\"/>\n", w, h);
+        for (int i = 0; i < 4; i++) {
+            int x = random.next(w);
+            int y = random.next(h);
+            int r = 20 + random.next(h / 2);
+            svg += fmt::format("  <circle cx=\"{}\" cy=\"{}\" r=\"{}\" fill=\"{}\" fill-opacity=\"0.35\"/>\n", x, y, r, random.color());
+        }
+        return svg + "</svg>\n";
+    }
+
+    void save_png(SDL_Surface *surface, const std::filesystem::path &path)
+    {
+        bool saved = IMG_SavePNG(surface, path.string().c_str());
+        SDL_DestroySurface(surface);
+        if (!saved)
+            throw std::runtime_error(fmt::format("Could not write '{}' (SDL Error: {})", path.string(), SDL_GetError()));
+    }
+
+    // Concentric rings with an antialiased transparent edge
+    SDL_Surface* png_icon(Random &random)
+    {
+        int w = random.next(2) ? 256 : 384;
+        int h = 256;
+        Uint8 c0[3] = {random.byte(), random.byte(), random.byte()};
+        Uint8 c1[3] = {random.byte(), random.byte(), random.byte()};
+        float rings = static_cast<float>(2 + random.next(6));
+        SDL_Surface *surface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+        float cx = static_cast<float>(w) / 2.f;
+        float cy = static_cast<float>(h) / 2.f;
+        float radius = std::min(cx, cy) - 2.f;
+        for (int y = 0; y < h; y++) {
+            Uint8 *row = static_cast<Uint8*>(surface->pixels) + y * surface->pitch;
+            for (int x = 0; x < w; x++) {
+                float dx = (static_cast<float>(x) + 0.5f - cx) * radius * 2.f / static_cast<float>(w);
+                float dy = static_cast<float>(y) + 0.5f - cy;
+                float d = std::sqrt(dx * dx + dy * dy);
+                bool ring = static_cast<int>(d / radius * rings) % 2;
+                const Uint8 *c = ring ? c1 : c0;
+                row[4 * x] = c[0];
+                row[4 * x + 1] = c[1];
+                row[4 * x + 2] = c[2];
+                row[4 * x + 3] = static_cast<Uint8>(std::clamp(radius - d, 0.f, 1.f) * 255.f);
+            }
+        }
+        return surface;
+    }
+
+    // Opaque diagonal gradient with stripes
+    SDL_Surface* png_background(Random &random, int w, int h)
+    {
+        Uint8 c0[3] = {random.byte(), random.byte(), random.byte()};
+        Uint8 c1[3] = {random.byte(), random.byte(), random.byte()};
+        int stripe = 16 + random.next(48);
+        SDL_Surface *surface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+        for (int y = 0; y < h; y++) {
+            Uint8 *row = static_cast<Uint8*>(surface->pixels) + y * surface->pitch;
+            for (int x = 0; x < w; x++) {
+                int t = (x + y) * 255 / (w + h);
+                int shade = ((x + y) / stripe) % 2 ? 24 : 0;
+                for (int i = 0; i < 3; i++)
+                    row[4 * x + i] = static_cast<Uint8>(std::max((c0[i] * (255 - t) + c1[i] * t) / 255 - shade, 0));
+                row[4 * x + 3] = 0xFF;
+            }
+        }
+        return surface;
+    }
+
+    AssetPool write_assets(Random &random, const std::filesystem::path &dir, int entries)
+    {
+        std::filesystem::create_directories(dir);
+        int size = std::clamp(entries / 20, MIN_POOL, MAX_POOL);
+        AssetPool pool;
+        for (int i = 0; i < size; i++) {
+            auto add = [&dir, i](std::vector<std::string> &list, const char *name, const char *extension) -> std::filesystem::path {
+                std::filesystem::path path = dir / fmt::format("{}-{:03}.{}", name, i, extension);
+                list.push_back(path.string());
+                return path;
+            };
+            write_file(add(pool.svg_icons, "icon", "svg"), svg_icon(random));
+            save_png(png_icon(random), add(pool.png_icons, "icon", "png"));
+            write_file(add(pool.svg_backgrounds, "background", "svg"), svg_background(random, CARD_W, CARD_H));
+            save_png(png_background(random, CARD_W, CARD_H), add(pool.png_backgrounds, "background", "png"));
+            write_file(add(pool.svg_cards, "card", "svg"), svg_background(random, CARD_W, CARD_H));
+            save_png(png_background(random, CARD_W, CARD_H), add(pool.png_cards, "card", "png"));
+        }
+        return pool;
+    }
+
+    const std::string& pick(Random &random, const std::vector<std::string> &list)
+    {
+        return list[random.next(static_cast<int>(list.size()))];
+    }
+
+    std::string icon_element(Random &random, const std::string &path)
+    {
+        // Margins are optional percentages, invalid ones are ignored in favour of the default
+        switch (random.next(6)) {
+            case 0:
+            case 1:
+                return fmt::format("<icon margin=\"{}%\">{}</icon>", 5 + random.next(20), path);
+
+            case 2:
+                return fmt::format("<icon margin=\"{}\">{}</icon>", random.next(2) ? "0.1" : "95%", path);
+
+            default:
+                return fmt::format("<icon>{}</icon>", path);
+        }
+    }
+
+    std::string entry_element(Random &random, const AssetPool &pool, int index)
+    {
+        std::string card;
+        std::string background;
+        switch (static_cast<CardKind>(index % static_cast<int>(CardKind::COUNT))) {
+            case CardKind::CUSTOM_SVG:
+                card = pick(random, pool.svg_cards);
+                break;
+
+            case CardKind::CUSTOM_PNG:
+                card = pick(random, pool.png_cards);
+                break;
+
+            case CardKind::SVG_ICON_COLOR:
+                card = icon_element(random, pick(random, pool.svg_icons));
+                background = random.color();
+                break;
+
+            case CardKind::PNG_ICON_COLOR:
+                card = icon_element(random, pick(random, pool.png_icons));
+                background = random.color();
+                break;
+
+            case CardKind::SVG_ICON_PNG_BACKGROUND:
+                card = icon_element(random, pick(random, pool.svg_icons));
+                background = pick(random, pool.png_backgrounds);
+                break;
+
+            case CardKind::PNG_ICON_SVG_BACKGROUND:
+                card = icon_element(random, pick(random, pool.png_icons));
+                background = pick(random, pool.svg_backgrounds);
+                break;
+
+            default:
+                card = icon_element(random, pick(random, pool.svg_icons));
+        }
+        if (card.starts_with("<icon")) {
+            if (!background.empty())
+                card += fmt::format("\n                <background>{}</background>", background);
+            card = fmt::format("\n                {}\n            ", card);
+        }
+        return fmt::format(
+            "        <entry title=\"Entry {0}\">\n"
+            "            <command>:fork echo entry {0}</command>\n"
+            "            <card>{1}</card>\n"
+            "        </entry>\n",
+            index, card
+        );
+    }
+
+    // Malformed and missing input, each one takes an error branch of the parser or the card renderer
+    std::string edge_case_menu(const AssetPool &pool)
+    {
+        const std::string &icon = pool.svg_icons.front();
+        std::string menu = "    <menu title=\"Edge cases\">\n";
+        menu += "        <entry><command>:fork echo no title</command><card>" + pool.svg_cards.front() + "</card></entry>\n";
+        menu += "        <entry title=\"No command\"><card>" + pool.svg_cards.front() + "</card></entry>\n";
+        menu += "        <entry title=\"No card\"><command>:fork echo no card</command></entry>\n";
+        menu += "        <entry title=\"No icon\"><command>:fork echo no icon</command><card><background>#FF0000</background></card></entry>\n";
+        menu += "        <entry title=\"Nested icon\"><command>:fork echo nested icon</command><card><icon><path>" + icon + "</path></icon></card></entry>\n";
+        menu += "        <entry title=\"Nested background\"><command>:fork echo nested background</command><card><icon>" + icon + "</icon><background><color>#FF0000</color></background></card></entry>\n";
+        menu += "        <entry title=\"Empty icon\"><command>:fork echo empty icon</command><card><icon></icon></card></entry>\n";
+        menu += "        <entry title=\"Missing card\"><command>:fork echo missing card</command><card>does-not-exist.svg</card></entry>\n";
+        menu += "        <entry title=\"Missing icon\"><command>:fork echo missing icon</command><card><icon>does-not-exist.png</icon><background>#00FF00</background></card></entry>\n";
+        menu += "        <entry title=\"Missing background\"><command>:fork echo missing background</command><card><icon>" + icon + "</icon><background>does-not-exist.png</background></card></entry>\n";
+        return menu + "    </menu>\n\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try {
+        Options options = parse_command_line(argc, argv);
+        Random random(options.seed);
+        std::filesystem::create_directories(options.dir);
+        std::filesystem::path dir = std::filesystem::absolute(options.dir);
+        AssetPool pool = write_assets(random, dir / "assets", options.entries);
+
+        std::string layout = "<layout>\n\n";
+        int index = 0;
+        for (int m = 0; m < options.menus; m++) {
+            int count = options.entries / options.menus + (m < options.entries % options.menus);
+            layout += fmt::format("    <menu title=\"Menu {}\">\n", m);
+            for (int i = 0; i < count; i++)
+                layout += entry_element(random, pool, index++);
+            layout += "    </menu>\n\n";
+        }
+        if (options.edge_cases)
+            layout += edge_case_menu(pool);
+        layout += "    <command title=\"Quit\">:quit</command>\n\n</layout>\n";
+        write_file(dir / "layout.xml", layout);
+
+        fmt::print("Wrote {} entries in {} menus to {}\n", options.entries, options.menus, (dir / "layout.xml").string());
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception &e) {
+        fmt::print(stderr, "Layout generation failed: {}\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,112 @@
+#include <cstdlib>
+#include <cerrno>
+#include <atomic>
+#include <new>
+#include "alloc_counter.hpp"
+
+#ifdef COUNT_ALLOCATIONS
+namespace {
+    std::atomic<Uint64> allocations{0};
+}
+
+// With glibc the malloc family is interposed, which also covers operator new and every library.
+// Elsewhere only operator new is replaced
+#ifdef __GLIBC__
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void *ptr, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void* __libc_valloc(size_t size);
+    void* __libc_pvalloc(size_t size);
+
+    void* malloc(size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void *ptr, size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+
+    // Aligned allocations, also used by aligned operator new. glibc only exports the memalign family
+    // under __libc names, the checks of aligned_alloc and posix_memalign are repeated here
+    void* memalign(size_t alignment, size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        if (!alignment || (alignment & (alignment - 1))) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **ptr, size_t alignment, size_t size) noexcept
+    {
+        if (alignment % sizeof(void*) || (alignment & (alignment - 1)))
+            return EINVAL;
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        void *p = __libc_memalign(alignment, size);
+        if (!p)
+            return ENOMEM;
+        *ptr = p;
+        return 0;
+    }
+
+    void* valloc(size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_valloc(size);
+    }
+
+    void* pvalloc(size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_pvalloc(size);
+    }
+}
+#else
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
+Uint64 BL::allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+#else
+Uint64 BL::allocation_count()
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+namespace BL {
+    // Heap allocations made by any thread since startup. Only counted in builds configured
+    // with COUNT_ALLOCATIONS, otherwise always 0
+    Uint64 allocation_count();
+}
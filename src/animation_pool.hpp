@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <SDL3/SDL.h>
+
+namespace BL {
+    // Fixed capacity storage for running animations. Slots are reused in place,
+    // so starting and finishing animations never touches the heap
+    template <typename T, size_t N>
+    class AnimationPool {
+    private:
+        std::array<T, N> slots{};
+        std::array<Uint64, N> started{}; // 0 if the slot is free, otherwise its start order
+        Uint64 next_start = 1;
+        size_t count = 0;
+
+    public:
+        bool empty() const { return !count; }
+        bool full() const { return count == N; }
+        size_t size() const { return count; }
+        static constexpr size_t capacity() { return N; }
+
+        // Returns a free slot, or nullptr if every slot is in use
+        T* acquire()
+        {
+            for (size_t i = 0; i < N; i++) {
+                if (!started[i]) {
+                    started[i] = next_start++;
+                    count++;
+                    return &slots[i];
+                }
+            }
+            return nullptr;
+        }
+
+        void release(T &slot)
+        {
+            started[&slot - slots.data()] = 0;
+            count--;
+        }
+
+        T* oldest()
+        {
+            T *slot = nullptr;
+            Uint64 order = 0;
+            for (size_t i = 0; i < N; i++) {
+                if (started[i] && (!slot || started[i] < order)) {
+                    slot = &slots[i];
+                    order = started[i];
+                }
+            }
+            return slot;
+        }
+
+        // Calls f on every running animation, f may release the slot it is given
+        template <typename F>
+        void for_each(F &&f)
+        {
+            for (size_t i = 0; i < N && count; i++) {
+                if (started[i])
+                    f(slots[i]);
+            }
+        }
+    };
+}
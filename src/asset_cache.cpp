@@ -0,0 +1,100 @@
+#include <string>
+#include <mutex>
+#include <SDL3/SDL.h>
+#include "logger.hpp"
+#include "external/nanosvg.h"
+#include "asset_cache.hpp"
+#include "card_cache.hpp"
+#include "image.hpp"
+
+BL::AssetCache::~AssetCache()
+{
+    for (auto &[path, slot] : svgs) {
+        if (slot->value)
+            nsvgDelete(slot->value);
+    }
+    for (auto &[path, slot] : images)
+        BL::free_surface(slot->value);
+    for (auto &[key, slot] : surfaces)
+        BL::free_surface(slot->value);
+}
+
+// The map is only locked for the lookup, the value is filled in once by the first caller
+template <typename K, typename T>
+BL::AssetCache::Slot<T>& BL::AssetCache::get_slot(std::unordered_map<K, std::unique_ptr<Slot<T>>> &map, const K &key)
+{
+    std::lock_guard lock(mutex);
+    auto &slot = map[key];
+    if (slot)
+        hits++;
+    else {
+        slot = std::make_unique<Slot<T>>();
+        misses++;
+    }
+    return *slot;
+}
+
+NSVGimage* BL::AssetCache::get_svg(BL::SVGRasterizer &rasterizer, const std::string &path)
+{
+    Slot<NSVGimage*> &slot = get_slot(svgs, path);
+    std::call_once(slot.once, [&] {
+        slot.value = rasterizer.parse_from_file(path.c_str(), "px", 96.0f);
+    });
+    return slot.value;
+}
+
+// Raster images are decoded once, the same surface gives their size and is scaled for every card size
+const SDL_Surface* BL::AssetCache::get_image(const std::string &path)
+{
+    Slot<SDL_Surface*> &slot = get_slot(images, path);
+    std::call_once(slot.once, [&] {
+        slot.value = BL::load_surface(path);
+    });
+    return slot.value;
+}
+
+// Natural size of an image
+bool BL::AssetCache::get_size(BL::SVGRasterizer &rasterizer, const std::string &path, float &w, float &h)
+{
+    Slot<Size> &slot = get_slot(sizes, path);
+    std::call_once(slot.once, [&] {
+        if (path.ends_with(".svg")) {
+            NSVGimage *image = get_svg(rasterizer, path);
+            if (image)
+                slot.value = {image->width, image->height};
+        }
+        else if (const SDL_Surface *image = get_image(path); image)
+            slot.value = {static_cast<float>(image->w), static_cast<float>(image->h)};
+    });
+    w = slot.value.w;
+    h = slot.value.h;
+    return w > 0.f && h > 0.f;
+}
+
+// Image rendered at exactly w x h, shared surfaces must only be read from
+const SDL_Surface* BL::AssetCache::get_surface(BL::SVGRasterizer &rasterizer, const std::string &path, int w, int h)
+{
+    Uint64 key = BL::Hasher().add(std::string_view(path)).add(w).add(h).get();
+    Slot<SDL_Surface*> &slot = get_slot(surfaces, key);
+    std::call_once(slot.once, [&] {
+        SDL_Surface *surface = nullptr;
+        if (path.ends_with(".svg")) {
+            NSVGimage *image = get_svg(rasterizer, path);
+            if (image)
+                surface = rasterizer.rasterize_svg_image(image, w, h);
+        }
+        else if (const SDL_Surface *image = get_image(path); image)
+            surface = BL::resize_surface(BL::copy_surface(*image), w, h);
+
+        // Images smaller than their rect are scaled up once here instead of at every blit
+        if (surface && (surface->w != w || surface->h != h)) {
+            SDL_Surface *scaled = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+            SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+            SDL_BlitSurfaceScaled(surface, nullptr, scaled, nullptr, SDL_SCALEMODE_LINEAR);
+            BL::free_surface(surface);
+            surface = scaled;
+        }
+        slot.value = surface;
+    });
+    return slot.value;
+}
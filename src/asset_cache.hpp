@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#include <SDL3/SDL.h>
+
+extern "C" {
+    struct NSVGimage;
+}
+
+namespace BL {
+    class SVGRasterizer;
+
+    // Interns the assets shared between cards, so each unique file is parsed and each unique
+    // (file, size) pair is rasterized once. Safe to use from the render pool
+    class AssetCache {
+    private:
+        template <typename T>
+        struct Slot {
+            std::once_flag once;
+            T value{};
+        };
+        struct Size {
+            float w = 0.f;
+            float h = 0.f;
+        };
+
+        std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Slot<NSVGimage*>>> svgs;
+        std::unordered_map<std::string, std::unique_ptr<Slot<Size>>> sizes;
+        std::unordered_map<std::string, std::unique_ptr<Slot<SDL_Surface*>>> images; // raster images at their natural size
+        std::unordered_map<Uint64, std::unique_ptr<Slot<SDL_Surface*>>> surfaces;
+        std::atomic<int> hits = 0;
+        std::atomic<int> misses = 0;
+
+        template <typename K, typename T>
+        Slot<T>& get_slot(std::unordered_map<K, std::unique_ptr<Slot<T>>> &map, const K &key);
+        const SDL_Surface* get_image(const std::string &path);
+
+    public:
+        AssetCache() = default;
+        ~AssetCache();
+
+        NSVGimage* get_svg(SVGRasterizer &rasterizer, const std::string &path);
+        bool get_size(SVGRasterizer &rasterizer, const std::string &path, float &w, float &h);
+        const SDL_Surface* get_surface(SVGRasterizer &rasterizer, const std::string &path, int w, int h);
+        int get_hits() const { return hits; }
+        int get_misses() const { return misses; }
+    };
+}
@@ -0,0 +1,286 @@
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "blur.hpp"
+#include "external/fast_gaussian_blur_template.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BL_BLUR_X86
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define BL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BL_TARGET_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define BL_BLUR_NEON
+#include <arm_neon.h>
+#endif
+
+// The SIMD path never runs a horizontal pass. Rows are transposed into columns and blurred with a
+// vertical sliding window, where every step adds and subtracts whole rows, so the window slides over
+// 16+ columns at once. Transposing first keeps the pass order of the scalar templates, and the
+// accumulators are integers that are exact in float, so both paths produce identical results.
+namespace BL {
+    constexpr int TRANSPOSE_TILE = 64;
+
+    // Adds src to acc, subtracts sub from acc and writes acc * iarr for columns [x, w)
+    inline void vertical_step_scalar(const Uint8 *add, const Uint8 *sub, Sint32 *acc, Uint8 *out, int x, int w, float iarr)
+    {
+        for (; x < w; x++) {
+            acc[x] += static_cast<Sint32>(add[x]) - static_cast<Sint32>(sub[x]);
+            out[x] = static_cast<Uint8>(static_cast<float>(acc[x]) * iarr);
+        }
+    }
+
+#ifdef BL_BLUR_X86
+    void vertical_step_sse2(const Uint8 *add, const Uint8 *sub, Sint32 *acc, Uint8 *out, int w, float iarr)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(iarr);
+        int x = 0;
+        for (; x + 16 <= w; x += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + x));
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + x));
+
+            // Widen the difference to 16 bits, then to 4x 32 bits
+            __m128i d_lo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(s, zero));
+            __m128i d_hi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(s, zero));
+            __m128i d[4] = {
+                _mm_srai_epi32(_mm_unpacklo_epi16(zero, d_lo), 16),
+                _mm_srai_epi32(_mm_unpackhi_epi16(zero, d_lo), 16),
+                _mm_srai_epi32(_mm_unpacklo_epi16(zero, d_hi), 16),
+                _mm_srai_epi32(_mm_unpackhi_epi16(zero, d_hi), 16)
+            };
+            __m128i v[4];
+            for (int i = 0; i < 4; i++) {
+                __m128i *p = reinterpret_cast<__m128i*>(acc + x + 4*i);
+                __m128i sum = _mm_add_epi32(_mm_loadu_si128(p), d[i]);
+                _mm_storeu_si128(p, sum);
+                v[i] = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), scale));
+            }
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), packed);
+        }
+        vertical_step_scalar(add, sub, acc, out, x, w, iarr);
+    }
+
+    BL_TARGET_AVX2 void vertical_step_avx2(const Uint8 *add, const Uint8 *sub, Sint32 *acc, Uint8 *out, int w, float iarr)
+    {
+        const __m256 scale = _mm256_set1_ps(iarr);
+        int x = 0;
+        for (; x + 16 <= w; x += 16) {
+            __m256i v[2];
+            for (int i = 0; i < 2; i++) {
+                __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(add + x + 8*i)));
+                __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(sub + x + 8*i)));
+                __m256i *p = reinterpret_cast<__m256i*>(acc + x + 8*i);
+                __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(p), _mm256_sub_epi32(a, s));
+                _mm256_storeu_si256(p, sum);
+                v[i] = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(sum), scale));
+            }
+
+            // Packing works per 128-bit lane, so restore the column order afterwards
+            __m256i packed = _mm256_packs_epi32(v[0], v[1]);
+            packed = _mm256_packus_epi16(packed, packed);
+            packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm256_castsi256_si128(packed));
+        }
+        vertical_step_scalar(add, sub, acc, out, x, w, iarr);
+    }
+
+    // Transposes a 16x16 block of bytes, four rounds of interleaving rows i and i + 8
+    inline void transpose_16x16_sse2(const Uint8 *in, int in_stride, Uint8 *out, int out_stride)
+    {
+        __m128i r[16];
+        __m128i t[16];
+        for (int i = 0; i < 16; i++)
+            r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * in_stride));
+        for (int round = 0; round < 4; round++) {
+            for (int i = 0; i < 8; i++) {
+                t[2*i] = _mm_unpacklo_epi8(r[i], r[i + 8]);
+                t[2*i + 1] = _mm_unpackhi_epi8(r[i], r[i + 8]);
+            }
+            std::copy(t, t + 16, r);
+        }
+        for (int i = 0; i < 16; i++)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * out_stride), r[i]);
+    }
+#endif
+
+#ifdef BL_BLUR_NEON
+    void vertical_step_neon(const Uint8 *add, const Uint8 *sub, Sint32 *acc, Uint8 *out, int w, float iarr)
+    {
+        const float32x4_t scale = vdupq_n_f32(iarr);
+        int x = 0;
+        for (; x + 16 <= w; x += 16) {
+            uint8x16_t a = vld1q_u8(add + x);
+            uint8x16_t s = vld1q_u8(sub + x);
+            int16x8_t d_lo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(a), vget_low_u8(s)));
+            int16x8_t d_hi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(a), vget_high_u8(s)));
+            int32x4_t d[4] = {
+                vmovl_s16(vget_low_s16(d_lo)),
+                vmovl_s16(vget_high_s16(d_lo)),
+                vmovl_s16(vget_low_s16(d_hi)),
+                vmovl_s16(vget_high_s16(d_hi))
+            };
+            uint16x4_t v[4];
+            for (int i = 0; i < 4; i++) {
+                int32x4_t sum = vaddq_s32(vld1q_s32(acc + x + 4*i), d[i]);
+                vst1q_s32(acc + x + 4*i, sum);
+                v[i] = vqmovun_s32(vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(sum), scale)));
+            }
+            uint8x16_t packed = vcombine_u8(
+                vqmovn_u16(vcombine_u16(v[0], v[1])),
+                vqmovn_u16(vcombine_u16(v[2], v[3]))
+            );
+            vst1q_u8(out + x, packed);
+        }
+        vertical_step_scalar(add, sub, acc, out, x, w, iarr);
+    }
+#endif
+
+    using VerticalStep = void (*)(const Uint8*, const Uint8*, Sint32*, Uint8*, int, float);
+
+    // Box blur of every column of a w x h buffer with border extend, the vertical equivalent of horizontal_blur_extend
+    void vertical_blur(const Uint8 *in, Uint8 *out, Sint32 *acc, int w, int h, int r, VerticalStep step)
+    {
+        float iarr = 1.f / static_cast<float>(r + r + 1);
+        const Uint8 *first = in;
+        const Uint8 *last = in + (h - 1) * w;
+        for (int x = 0; x < w; x++)
+            acc[x] = (r + 1) * first[x];
+        for (int y = 0; y < r; y++) {
+            const Uint8 *row = y < h ? in + y * w : last;
+            for (int x = 0; x < w; x++)
+                acc[x] += row[x];
+        }
+        for (int y = 0; y < h; y++) {
+            int ri = y + r;
+            int li = y - r - 1;
+            const Uint8 *add = ri < h ? in + ri * w : last;
+            const Uint8 *sub = li >= 0 ? in + li * w : first;
+            step(add, sub, acc, out + y * w, w, iarr);
+        }
+    }
+
+    // Cache tiled transpose, with 16x16 SIMD blocks where available
+    void transpose(const Uint8 *in, Uint8 *out, int w, int h, BlurKernels kernels)
+    {
+        for (int ty = 0; ty < h; ty += TRANSPOSE_TILE) {
+            for (int tx = 0; tx < w; tx += TRANSPOSE_TILE) {
+                int y_end = std::min(h, ty + TRANSPOSE_TILE);
+                int x_end = std::min(w, tx + TRANSPOSE_TILE);
+                int y = ty;
+#ifdef BL_BLUR_X86
+                if (kernels != BlurKernels::SCALAR) {
+                    for (; y + 16 <= y_end; y += 16) {
+                        int x = tx;
+                        for (; x + 16 <= x_end; x += 16)
+                            transpose_16x16_sse2(in + y * w + x, w, out + x * h + y, h);
+                        for (; x < x_end; x++) {
+                            for (int yy = y; yy < y + 16; yy++)
+                                out[x * h + yy] = in[yy * w + x];
+                        }
+                    }
+                }
+#endif
+                for (; y < y_end; y++) {
+                    for (int x = tx; x < x_end; x++)
+                        out[x * h + y] = in[y * w + x];
+                }
+            }
+        }
+    }
+
+    VerticalStep get_vertical_step(BlurKernels kernels)
+    {
+        switch (kernels) {
+#ifdef BL_BLUR_X86
+            case BlurKernels::SSE2:
+                return vertical_step_sse2;
+
+            case BlurKernels::AVX2:
+                return vertical_step_avx2;
+#endif
+#ifdef BL_BLUR_NEON
+            case BlurKernels::NEON:
+                return vertical_step_neon;
+#endif
+            default:
+                return nullptr;
+        }
+    }
+}
+
+bool BL::blur_kernels_supported(BL::BlurKernels kernels)
+{
+    switch (kernels) {
+        case BlurKernels::SCALAR:
+            return true;
+
+#ifdef BL_BLUR_X86
+        case BlurKernels::SSE2:
+            return SDL_HasSSE2();
+
+        case BlurKernels::AVX2:
+            return SDL_HasAVX2();
+#endif
+#ifdef BL_BLUR_NEON
+        case BlurKernels::NEON:
+            return SDL_HasNEON();
+#endif
+        default:
+            return false;
+    }
+}
+
+// Detected once, the best kernels supported by the CPU
+BL::BlurKernels BL::get_blur_kernels()
+{
+    static const BL::BlurKernels kernels = [] {
+        for (BL::BlurKernels k : {BlurKernels::AVX2, BlurKernels::NEON, BlurKernels::SSE2}) {
+            if (blur_kernels_supported(k))
+                return k;
+        }
+        return BlurKernels::SCALAR;
+    }();
+    return kernels;
+}
+
+void BL::blur_alpha(Uint8 *buffer, Uint8 *scratch, int w, int h, float sigma)
+{
+    blur_alpha(buffer, scratch, w, h, sigma, get_blur_kernels());
+}
+
+void BL::blur_alpha(Uint8 *buffer, Uint8 *scratch, int w, int h, float sigma, BL::BlurKernels kernels)
+{
+    int boxes[3];
+    sigma_to_box_radius(boxes, sigma, 3);
+    BL::VerticalStep step = BL::get_vertical_step(kernels);
+
+    // Fall back to the reference templates
+    if (!step) {
+        horizontal_blur<Uint8, 1>(buffer, scratch, w, h, boxes[0]);
+        horizontal_blur<Uint8, 1>(scratch, buffer, w, h, boxes[1]);
+        horizontal_blur<Uint8, 1>(buffer, scratch, w, h, boxes[2]);
+        flip_block<Uint8, 1>(scratch, buffer, w, h);
+        horizontal_blur<Uint8, 1>(buffer, scratch, h, w, boxes[0]);
+        horizontal_blur<Uint8, 1>(scratch, buffer, h, w, boxes[1]);
+        horizontal_blur<Uint8, 1>(buffer, scratch, h, w, boxes[2]);
+        flip_block<Uint8, 1>(scratch, buffer, h, w);
+        return;
+    }
+
+    // Rows first (as columns of the transposed buffer), then columns
+    std::vector<Sint32> acc(std::max(w, h));
+    BL::transpose(buffer, scratch, w, h, kernels);
+    BL::vertical_blur(scratch, buffer, acc.data(), h, w, boxes[0], step);
+    BL::vertical_blur(buffer, scratch, acc.data(), h, w, boxes[1], step);
+    BL::vertical_blur(scratch, buffer, acc.data(), h, w, boxes[2], step);
+    BL::transpose(buffer, scratch, h, w, kernels);
+    BL::vertical_blur(scratch, buffer, acc.data(), w, h, boxes[0], step);
+    BL::vertical_blur(buffer, scratch, acc.data(), w, h, boxes[1], step);
+    BL::vertical_blur(scratch, buffer, acc.data(), w, h, boxes[2], step);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+namespace BL {
+    // Instruction sets the single channel blur kernels are available for
+    enum class BlurKernels {
+        SCALAR,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    BlurKernels get_blur_kernels();
+    bool blur_kernels_supported(BlurKernels kernels);
+
+    // 3-pass box blur approximating a Gaussian, applied in place, scratch must be the same size as buffer
+    void blur_alpha(Uint8 *buffer, Uint8 *scratch, int w, int h, float sigma);
+    void blur_alpha(Uint8 *buffer, Uint8 *scratch, int w, int h, float sigma, BlurKernels kernels);
+}
@@ -0,0 +1,228 @@
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#ifdef __unix__
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#include <process.h>
+#endif
+#include <fmt/core.h>
+#include <SDL3/SDL.h>
+#include "logger.hpp"
+#include <lconfig.h>
+#include "card_cache.hpp"
+#include "image.hpp"
+#include "util.hpp"
+
+extern const char *executable_dir;
+
+namespace BL {
+    constexpr char CARD_CACHE_MAGIC[4] = {'B', 'L', 'C', 'C'};
+    constexpr Uint32 CARD_CACHE_VERSION = 3;
+    constexpr uintmax_t CARD_CACHE_MAX_BYTES = 256 * 1024 * 1024;
+    constexpr auto CARD_CACHE_TMP_AGE = std::chrono::hours(24); // older temporary files are left over from crashes
+    struct CardCacheHeader {
+        char magic[4];
+        Uint32 w;
+        Uint32 h;
+    };
+}
+
+// Mixes the modification time and size of a file into the hash, so edited assets invalidate their entries
+BL::Hasher& BL::Hasher::add_file(const std::string &path)
+{
+    add(std::string_view(path));
+    if (path.empty())
+        return *this;
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (!ec)
+        add(mtime.time_since_epoch().count());
+    auto size = std::filesystem::file_size(path, ec);
+    if (!ec)
+        add(size);
+    return *this;
+}
+
+// BoxShadow has padding after alpha, so its members are hashed one by one instead of its bytes
+Uint64 BL::CardCache::make_seed(const std::vector<BoxShadow> &box_shadows, float shadow_offset, float card_w, float card_h)
+{
+    Hasher hasher;
+    hasher.add(BL::CARD_CACHE_VERSION)
+          .add(card_w)
+          .add(card_h)
+          .add(shadow_offset);
+    for (const BoxShadow &bs : box_shadows) {
+        hasher.add(bs.x_offset)
+              .add(bs.y_offset)
+              .add(bs.radius)
+              .add(bs.alpha);
+    }
+    return hasher.get();
+}
+
+BL::CardCache::CardCache(const std::vector<BoxShadow> &box_shadows, float shadow_offset, float card_w, float card_h):
+    seed(make_seed(box_shadows, shadow_offset, card_w, card_h))
+{
+
+#ifdef __unix__
+    const char *cache_home = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (cache_home && *cache_home)
+        dir = BL::join_paths(cache_home, EXECUTABLE_TITLE);
+    else if (home && *home)
+        dir = BL::join_paths(home, ".cache", EXECUTABLE_TITLE);
+    else {
+        BL::logger::error("Neither XDG_CACHE_HOME nor HOME is set, card cache disabled");
+        enabled = false;
+        return;
+    }
+#endif
+#ifdef _WIN32
+    dir = BL::join_paths(executable_dir, "cache");
+#endif
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        BL::logger::error("Could not create card cache directory '{}'", dir.string());
+        enabled = false;
+        return;
+    }
+    clean();
+}
+
+// Entries are named after the seed, so the ones written with other card settings or by another cache
+// version can be told apart and removed. The rest are removed least recently used first until the cache
+// fits in CARD_CACHE_MAX_BYTES, loading an entry marks it as used
+void BL::CardCache::clean()
+{
+    struct Entry {
+        std::filesystem::file_time_type time;
+        uintmax_t size;
+        std::filesystem::path path;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+    int removed = 0;
+    std::string prefix = fmt::format("{:016x}-", seed);
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for (const std::filesystem::directory_entry &file : std::filesystem::directory_iterator(dir, ec)) {
+        std::string name = file.path().filename().string();
+        std::error_code file_ec;
+        if (!file.is_regular_file(file_ec) || !(name.ends_with(".card") || name.ends_with(".tmp")))
+            continue;
+        auto time = file.last_write_time(file_ec);
+        if (file_ec)
+            continue;
+        bool current = name.starts_with(prefix);
+        if (current && name.ends_with(".card")) {
+            uintmax_t size = file.file_size(file_ec);
+            if (!file_ec) {
+                entries.push_back({time, size, file.path()});
+                total += size;
+            }
+        }
+        else if (!current || now - time > BL::CARD_CACHE_TMP_AGE)
+            removed += std::filesystem::remove(file.path(), file_ec);
+    }
+
+    if (total > BL::CARD_CACHE_MAX_BYTES) {
+        std::ranges::sort(entries, {}, &Entry::time);
+        for (const Entry &entry : entries) {
+            if (total <= BL::CARD_CACHE_MAX_BYTES)
+                break;
+            std::error_code file_ec;
+            if (std::filesystem::remove(entry.path, file_ec)) {
+                total -= entry.size;
+                removed++;
+            }
+        }
+    }
+    if (removed)
+        BL::logger::debug("Removed {} stale card cache files", removed);
+}
+
+std::filesystem::path BL::CardCache::get_path(Uint64 key) const
+{
+    return BL::join_paths(dir, fmt::format("{:016x}-{:016x}.card", seed, BL::Hasher(seed).add(key).get()));
+}
+
+SDL_Surface* BL::CardCache::load(Uint64 key, int w, int h)
+{
+    if (!enabled) {
+        misses++;
+        return nullptr;
+    }
+    std::filesystem::path path = get_path(key);
+    std::ifstream file(path, std::ios::binary);
+    BL::CardCacheHeader header;
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+    memcmp(header.magic, BL::CARD_CACHE_MAGIC, sizeof(header.magic)) ||
+    header.w != static_cast<Uint32>(w) || header.h != static_cast<Uint32>(h)) {
+        misses++;
+        return nullptr;
+    }
+
+    SDL_Surface *surface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        BL::logger::error("Could not create surface for cached card (SDL Error: {})", SDL_GetError());
+        misses++;
+        return nullptr;
+    }
+    auto pixels = static_cast<char*>(surface->pixels);
+    for (int y = 0; y < h; y++) {
+        if (!file.read(pixels + y * surface->pitch, 4 * w)) {
+            BL::free_surface(surface);
+            misses++;
+            return nullptr;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    hits++;
+    return surface;
+}
+
+void BL::CardCache::store(Uint64 key, SDL_Surface &surface)
+{
+    if (!enabled || surface.format != SDL_PIXELFORMAT_RGBA32)
+        return;
+
+    // Write to a temporary file first so an interrupted write can never be read back as a valid entry.
+    // Identical cards share a key and may be stored concurrently, also by other launcher instances,
+    // so every writer gets its own temporary file
+    std::filesystem::path path = get_path(key);
+    std::filesystem::path tmp_path = path;
+#ifdef _WIN32
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+    tmp_path += fmt::format(".{}.{}.tmp", pid, tmp_count++);
+    bool written;
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        BL::CardCacheHeader header;
+        memcpy(header.magic, BL::CARD_CACHE_MAGIC, sizeof(header.magic));
+        header.w = static_cast<Uint32>(surface.w);
+        header.h = static_cast<Uint32>(surface.h);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        auto pixels = static_cast<const char*>(surface.pixels);
+        for (int y = 0; y < surface.h; y++)
+            file.write(pixels + y * surface.pitch, 4 * surface.w);
+        written = static_cast<bool>(file);
+    }
+    std::error_code ec;
+    if (written)
+        std::filesystem::rename(tmp_path, path, ec);
+    if (!written || ec) {
+        BL::logger::error("Could not write card cache file '{}'", path.string());
+        std::filesystem::remove(tmp_path, ec);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <filesystem>
+#include <type_traits>
+
+#include <SDL3/SDL.h>
+
+struct BoxShadow;
+
+namespace BL {
+    // 64-bit FNV-1a hash used to build content-addressed cache keys
+    class Hasher {
+    private:
+        static constexpr Uint64 FNV_OFFSET = 0xcbf29ce484222325ULL;
+        static constexpr Uint64 FNV_PRIME = 0x100000001b3ULL;
+        Uint64 value;
+
+    public:
+        Hasher(Uint64 seed = FNV_OFFSET): value(seed) {}
+        Hasher& add(const void *data, size_t size)
+        {
+            auto p = static_cast<const Uint8*>(data);
+            for (size_t i = 0; i < size; i++) {
+                value ^= p[i];
+                value *= FNV_PRIME;
+            }
+            return *this;
+        }
+        template <typename T> requires std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>
+        Hasher& add(const T &t) { return add(&t, sizeof(T)); }
+        Hasher& add(float f) { return add(&f, sizeof(f)); }
+        Hasher& add(std::string_view string) { add(string.size()); return add(string.data(), string.size()); }
+        Hasher& add_file(const std::string &path);
+        Uint64 get() const { return value; }
+    };
+
+    // Persistent cache of fully composed card surfaces, keyed by everything that affects the output
+    class CardCache {
+    private:
+        std::filesystem::path dir;
+        Uint64 seed;
+        std::atomic<int> hits = 0;
+        std::atomic<int> misses = 0;
+        std::atomic<int> tmp_count = 0;
+        bool enabled = true;
+
+        std::filesystem::path get_path(Uint64 key) const;
+        void clean();
+
+    public:
+        CardCache(const std::vector<BoxShadow> &box_shadows, float shadow_offset, float card_w, float card_h);
+        ~CardCache() = default;
+
+        static Uint64 make_seed(const std::vector<BoxShadow> &box_shadows, float shadow_offset, float card_w, float card_h);
+        SDL_Surface* load(Uint64 key, int w, int h);
+        void store(Uint64 key, SDL_Surface &surface);
+        int get_hits() const { return hits; }
+        int get_misses() const { return misses; }
+    };
+}
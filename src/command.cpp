@@ -0,0 +1,81 @@
+#include <string>
+#include <string_view>
+#include <cstring>
+#include "command.hpp"
+
+namespace BL {
+    // Characters that make a command line need a shell wherever they appear unquoted
+    constexpr const char *SHELL_CHARACTERS = "|&;<>()$`*?[";
+}
+
+BL::Command::Command(const std::string &line) : line(line)
+{
+    if (is_fork()) {
+        size_t space = line.find_first_of(' ');
+        size_t begin = space == std::string::npos ? std::string::npos : line.find_first_not_of(' ', space);
+        process_begin = begin == std::string::npos ? line.size() : begin;
+    }
+    else if (is_special())
+        return;
+    tokenize();
+}
+
+// Splits the process command line the way /bin/sh would for plain words, quotes and backslash escapes.
+// Anything beyond that, such as variables, globs, pipes or redirections, leaves the arguments empty
+void BL::Command::tokenize()
+{
+    std::string_view string = get_process_line();
+    std::string arg;
+    bool in_arg = false;
+    bool quoted = false;
+    auto use_shell = [this]() { args.clear(); };
+
+    for (size_t i = 0; i < string.size(); i++) {
+        char c = string[i];
+        if (c == '\'') {
+            size_t end = string.find('\'', i + 1);
+            if (end == std::string_view::npos)
+                return use_shell();
+            arg.append(string.substr(i + 1, end - i - 1));
+            in_arg = quoted = true;
+            i = end;
+        }
+        else if (c == '"') {
+            for (i++; i < string.size() && string[i] != '"'; i++) {
+                if (string[i] == '$' || string[i] == '`')
+                    return use_shell();
+                if (string[i] == '\\' && i + 1 < string.size() && std::strchr("\"\\$`", string[i + 1]))
+                    i++;
+                arg.push_back(string[i]);
+            }
+            if (i == string.size())
+                return use_shell();
+            in_arg = quoted = true;
+        }
+        else if (c == '\\') {
+            if (++i == string.size())
+                return use_shell();
+            arg.push_back(string[i]);
+            in_arg = true;
+        }
+        else if (c == ' ' || c == '\t' || c == '\n') {
+            if (in_arg) {
+                args.push_back(std::move(arg));
+                arg.clear();
+                in_arg = false;
+            }
+        }
+        else if (std::strchr(BL::SHELL_CHARACTERS, c) || (!in_arg && (c == '#' || c == '~')))
+            return use_shell();
+
+        // A variable assignment in front of the program
+        else if (c == '=' && args.empty() && !quoted)
+            return use_shell();
+        else {
+            arg.push_back(c);
+            in_arg = true;
+        }
+    }
+    if (in_arg)
+        args.push_back(std::move(arg));
+}
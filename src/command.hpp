@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BL {
+    // A command from the layout or config file. Process commands are split into arguments
+    // once when they are loaded, lines that use shell syntax are left to /bin/sh
+    class Command {
+    private:
+        std::string line;
+        size_t process_begin = 0; // start of the process command line, after ':fork'
+        std::vector<std::string> args; // empty if the process command line needs a shell
+
+        void tokenize();
+
+    public:
+        Command(const std::string &line);
+        Command(const char *line) : Command(std::string(line)) {}
+        ~Command() = default;
+
+        const std::string& get_line() const { return line; }
+        bool is_special() const { return !line.empty() && line.front() == ':'; }
+        bool is_fork() const { return line == ":fork" || line.starts_with(":fork "); }
+        std::string_view get_process_line() const { return std::string_view(line).substr(process_begin); }
+        const std::vector<std::string>& get_args() const { return args; }
+        bool needs_shell() const { return args.empty(); }
+    };
+}
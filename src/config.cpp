@@ -36,6 +36,12 @@ int BL::handler(void* user, const char* section, const char* name, const char* v
             BL::hex_to_color(value, config.menu_highlight_color);
         else if (MATCH(name, "BackgroundImage"))
             config.add_path(value, config.background_image_path);
+        else if (MATCH(name, "CardCache"))
+            config.add_bool(value, config.card_cache);
+        else if (MATCH(name, "TextureMemory"))
+            config.add_int(value, config.texture_budget);
+        else if (MATCH(name, "RenderOnDemand"))
+            config.add_bool(value, config.render_on_demand);
     }
 
     else if (MATCH(section, "Sound")) {
@@ -159,27 +165,9 @@ void BL::Config::add_gamepad_control(const char *key, const char *value)
         {"ButtonDPadRight",  {GamepadControl::Type::BUTTON,  GamepadControl::Direction::NONE, SDL_GAMEPAD_BUTTON_DPAD_RIGHT}}
     };
 
-    static const SDL_GamepadAxis opposing_axes[] = {
-        SDL_GAMEPAD_AXIS_LEFTY,
-        SDL_GAMEPAD_AXIS_LEFTX,
-        SDL_GAMEPAD_AXIS_RIGHTY,
-        SDL_GAMEPAD_AXIS_RIGHTX,
-    };
-
     auto it = infos.find(key);
     if (it != infos.end()) {
         const GamepadInfo &info = it->second;
         config.gamepad_controls.emplace_back(info.type, info.index, info.direction, it->first, value);
-
-        // Add control stick for axis if it doesn't already exist
-        if (info.type == GamepadControl::Type::LSTICK || info.type == GamepadControl::Type::RSTICK) {
-            SDL_GamepadAxis opposing_axis = opposing_axes[info.index];
-            auto a = std::find_if(config.gamepad_sticks.begin(),
-                        config.gamepad_sticks.end(),
-                        [&](auto &stick) { return stick.axes[0] == info.index || stick.axes[1] == info.index; }
-                     );
-            if (a == config.gamepad_sticks.end())
-                config.gamepad_sticks.push_back(BL::GamepadStick(info.type, {(SDL_GamepadAxis) info.index, opposing_axis}));
-        }
     }
 }
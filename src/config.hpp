@@ -27,17 +27,13 @@ namespace BL {
         Type                       type;
         int                        index;
         GamepadControl::Direction  direction;
-        int                        repeat = 0;
+        int                        holds = 0;         // number of controllers holding the control
+        Uint64                     repeat_time = 0;   // when the held control fires next
         std::string                label;
-        std::string                command;
+        Command                    command;
         GamepadControl(Type type, int index, GamepadControl::Direction direction, const std::string &label, const char *cmd) 
         : type(type), index(index), direction(direction), label(label), command(cmd) {}
     };
-    struct GamepadStick {
-        GamepadControl::Type type;
-        std::array<SDL_GamepadAxis, 2> axes;
-        GamepadStick(GamepadControl::Type type, std::array<SDL_GamepadAxis, 2> axes): type(type), axes(axes) {}
-    };
     class Config {
     public:
         SDL_Color sidebar_highlight_color = {0x00, 0x00, 0xFF, 0xFF};
@@ -46,6 +42,9 @@ namespace BL {
         SDL_Color menu_highlight_color = {0xFF, 0xFF, 0xFF, 0xFF};
         std::string background_image_path;
         bool mouse_select = false;
+        bool card_cache = true;
+        int texture_budget = 512; // MB
+        bool render_on_demand = true;
         bool debug = false;
         bool sound_enabled = false;
         int sound_volume;
@@ -57,7 +56,6 @@ namespace BL {
         std::string gamepad_mappings_file;
         HotkeyList hotkey_list;
         std::vector<GamepadControl> gamepad_controls;
-        std::vector<GamepadStick> gamepad_sticks;
 #ifdef DEBUG
         int render_w = 0;
         int render_h = 0;
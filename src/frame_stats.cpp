@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <bit>
+#include <fmt/core.h>
+#include <SDL3/SDL.h>
+#include "logger.hpp"
+#include "frame_stats.hpp"
+#include "alloc_counter.hpp"
+
+extern BL::FrameStats frame_stats;
+
+namespace BL {
+    constexpr float AVERAGE_WEIGHT = 0.05f; // exponential moving average, roughly the last 20 frames
+}
+
+
+// Frame times run from one end_frame() to the next, so they include vsync and any waiting
+void BL::FrameStats::end_frame()
+{
+    Uint64 now = SDL_GetTicksNS();
+    if (last_frame) {
+        float ms = static_cast<float>(now - last_frame) / 1e6f;
+        frame_ms[history_pos] = ms;
+        history_pos = (history_pos + 1) % HISTORY;
+        average_frame_ms = frames ? average_frame_ms + BL::AVERAGE_WEIGHT * (ms - average_frame_ms) : ms;
+        max_frame_ms = std::max(max_frame_ms, ms);
+        total_frame_ms += ms;
+        for (int i = 0; i < NUM_STAGES; i++) {
+            float stage = static_cast<float>(stage_ns[i]) / 1e6f;
+            average_ms[i] = frames ? average_ms[i] + BL::AVERAGE_WEIGHT * (stage - average_ms[i]) : stage;
+            max_ms[i] = std::max(max_ms[i], stage);
+            total_ms[i] += stage;
+        }
+        frames++;
+    }
+    last_frame = now;
+    stage_ns.fill(0);
+    frame_draw_calls = draw_calls;
+    draw_calls = 0;
+    Uint64 allocations = BL::allocation_count();
+    frame_allocations = allocations - last_allocations;
+    last_allocations = allocations;
+    if (frame_allocations)
+        allocating_frames++;
+    allocation_histogram[std::min<size_t>(std::bit_width(frame_allocations), ALLOCATION_BUCKETS - 1)]++;
+}
+
+void BL::FrameStats::log_summary() const
+{
+    if (!frames)
+        return;
+    double f_frames = static_cast<double>(frames);
+    BL::logger::debug("Frame statistics over {} frames:", frames);
+    BL::logger::debug("  {:<10}{:8.3f} ms avg {:8.3f} ms max ({:.1f} FPS)", "frame", total_frame_ms / f_frames, max_frame_ms, 1000.0 * f_frames / total_frame_ms);
+    for (int i = 0; i < NUM_STAGES; i++)
+        BL::logger::debug("  {:<10}{:8.3f} ms avg {:8.3f} ms max", stage_name(static_cast<Stage>(i)), total_ms[i] / f_frames, max_ms[i]);
+#ifdef COUNT_ALLOCATIONS
+    BL::logger::debug("  {} frames allocated from the heap", allocating_frames);
+#endif
+}
+
+// Bucket i > 0 holds the frames with 2^(i-1) to 2^i - 1 allocations
+void BL::FrameStats::print_allocation_histogram() const
+{
+    fmt::print("Heap allocations per frame:\n");
+    for (int i = 0; i < ALLOCATION_BUCKETS; i++) {
+        if (!allocation_histogram[i])
+            continue;
+        if (i == 0)
+            fmt::print("  {:>11}  {} frames\n", 0, allocation_histogram[i]);
+        else if (i == ALLOCATION_BUCKETS - 1)
+            fmt::print("  {:>11}  {} frames\n", fmt::format("{}+", 1ull << (i - 1)), allocation_histogram[i]);
+        else
+            fmt::print("  {:>11}  {} frames\n", fmt::format("{}-{}", 1ull << (i - 1), (1ull << i) - 1), allocation_histogram[i]);
+    }
+}
+
+const char* BL::FrameStats::stage_name(Stage stage)
+{
+    switch (stage) {
+        case UPDATE:
+            return "update";
+
+        case EVENTS:
+            return "events";
+
+        case GAMEPAD:
+            return "gamepad";
+
+        case DRAW:
+            return "draw";
+
+        case PRESENT:
+            return "present";
+
+        default:
+            return "";
+    }
+}
+
+BL::StageScope::~StageScope()
+{
+    frame_stats.add_stage(stage, begin);
+}
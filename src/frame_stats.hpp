@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+
+#include <SDL3/SDL.h>
+
+namespace BL {
+    // Lightweight per-frame counters, shown by the stats overlay and summarized on exit
+    class FrameStats {
+    public:
+        enum Stage {
+            UPDATE,
+            EVENTS,
+            GAMEPAD,
+            DRAW,
+            PRESENT,
+            NUM_STAGES
+        };
+        static constexpr int HISTORY = 120; // frames kept for the frame time graph
+        static constexpr int ALLOCATION_BUCKETS = 12;
+
+    private:
+        Uint64 last_frame = 0;
+        std::array<Uint64, NUM_STAGES> stage_ns{};
+        std::array<float, NUM_STAGES> average_ms{};
+        std::array<float, NUM_STAGES> max_ms{};
+        std::array<double, NUM_STAGES> total_ms{};
+        std::array<float, HISTORY> frame_ms{};
+        int history_pos = 0;
+        float average_frame_ms = 0.f;
+        float max_frame_ms = 0.f;
+        double total_frame_ms = 0.0;
+        Uint64 frames = 0;
+        int draw_calls = 0;
+        int frame_draw_calls = 0;
+        int live_textures = 0;
+        Uint64 last_allocations = 0;
+        Uint64 frame_allocations = 0;
+        Uint64 allocating_frames = 0;
+        std::array<Uint64, ALLOCATION_BUCKETS> allocation_histogram{};
+
+    public:
+        FrameStats() = default;
+        ~FrameStats() = default;
+
+        void add_stage(Stage stage, Uint64 begin_ns) { stage_ns[stage] += SDL_GetTicksNS() - begin_ns; }
+        void add_draw_call() { draw_calls++; }
+        void add_texture() { live_textures++; }
+        void remove_texture() { live_textures--; }
+        void end_frame();
+        void pause() { last_frame = 0; }
+
+        float get_average_ms(Stage stage) const { return average_ms[stage]; }
+        float get_average_frame_ms() const { return average_frame_ms; }
+        float get_max_frame_ms() const { return max_frame_ms; }
+        float get_frame_ms(int i) const { return frame_ms[(history_pos + i) % HISTORY]; } // oldest first
+        int get_draw_calls() const { return frame_draw_calls; }
+        int get_live_textures() const { return live_textures; }
+        Uint64 get_allocations() const { return frame_allocations; }
+        Uint64 get_allocating_frames() const { return allocating_frames; }
+        void log_summary() const;
+        void print_allocation_histogram() const;
+
+        static const char* stage_name(Stage stage);
+    };
+
+    class StageScope {
+    private:
+        FrameStats::Stage stage;
+        Uint64 begin;
+
+    public:
+        StageScope(FrameStats::Stage stage): stage(stage), begin(SDL_GetTicksNS()) {}
+        ~StageScope();
+    };
+}
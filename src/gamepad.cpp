@@ -13,7 +13,7 @@ namespace BL {
     constexpr int GAMEPAD_REPEAT_INTERVAL = 25;
 }
 
-BL::Gamepad::Gamepad(int refresh_period, const std::string &gamepad_mappings_file, BL::Launcher &launcher):
+BL::Gamepad::Gamepad(const std::string &gamepad_mappings_file, BL::Launcher &launcher):
     launcher(launcher)
 {
     BL::logger::debug("Initializing game controller subsystem...");
@@ -23,9 +23,6 @@ BL::Gamepad::Gamepad(int refresh_period, const std::string &gamepad_mappings_fil
     }
     BL::logger::debug("Successfully initialized game controller subsystem");
 
-    delay_period = BL::GAMEPAD_REPEAT_DELAY / refresh_period;
-    repeat_period = BL::GAMEPAD_REPEAT_INTERVAL / refresh_period;
-
     if (!gamepad_mappings_file.empty()) {
         if (SDL_AddGamepadMappingsFromFile(gamepad_mappings_file.c_str()) < 0) {
             BL::logger::error("Could not load gamepad mappings from file '{}'", 
@@ -33,125 +30,218 @@ BL::Gamepad::Gamepad(int refresh_period, const std::string &gamepad_mappings_fil
             );
         }
     }
+
+    // Build the lookup from inputs to controls
+    for (GamepadControl &control : config.gamepad_controls) {
+        switch (control.type) {
+            case GamepadControl::Type::BUTTON:
+                button_controls[control.index].push_back(&control);
+                break;
+
+            case GamepadControl::Type::TRIGGER:
+                trigger_controls[control.index].push_back(&control);
+                break;
+
+            default:
+                stick_controls[control.type][control.direction] = &control;
+        }
+    }
 }
 
 BL::Gamepad::~Gamepad()
 {
-    for (auto& [id, gamepad] : controllers)
-        SDL_CloseGamepad(gamepad);
+    for (auto& [id, controller] : controllers)
+        SDL_CloseGamepad(controller.gamepad);
 }
 
 void BL::Gamepad::add(int id)
 {
     SDL_Gamepad *gamepad = SDL_OpenGamepad(id);
     if (gamepad)
-        controllers[id] = gamepad;
+        controllers.try_emplace(id, gamepad);
 }
 
 void BL::Gamepad::remove(int id)
 {
     auto it = controllers.find(id);
     if (it != controllers.end()) {
-        SDL_CloseGamepad(it->second);
+        release_all(it->second);
+        SDL_CloseGamepad(it->second.gamepad);
         controllers.erase(it);
     }
 }
 
 void BL::Gamepad::connect()
 {
-    for (auto& [id, gamepad] : controllers)
-        gamepad = SDL_OpenGamepad(id);
+    for (auto& [id, controller] : controllers)
+        controller.gamepad = SDL_OpenGamepad(id);
 }
 
 void BL::Gamepad::disconnect()
 {
-    for (auto& [id, gamepad] : controllers) {
-        SDL_CloseGamepad(gamepad);
-        gamepad = nullptr;
+    for (auto& [id, controller] : controllers) {
+        release_all(controller);
+        SDL_CloseGamepad(controller.gamepad);
+        controller.gamepad = nullptr;
     }
 }
 
-bool BL::Gamepad::poll()
+// The control a stick points at, if it is outside the deadzone and within range of the control's direction
+BL::GamepadControl* BL::Gamepad::get_stick_control(const Controller &controller, GamepadControl::Type stick) const
 {
-    bool ret = false;
-    // Poll sticks
-    if (!config.gamepad_sticks.empty()) {
-        AxisType axis_type;
-        for (auto stick = config.gamepad_sticks.begin(); stick != config.gamepad_sticks.end() && !selected_axis; ++stick) {
-            for (auto controller = controllers.begin(); controller != controllers.end() && !selected_axis; ++controller) {
-                // Poll individual axes in stick
-                for (auto axis : stick->axes) {
-                    axis_type = (axis == SDL_GAMEPAD_AXIS_LEFTX || axis == SDL_GAMEPAD_AXIS_RIGHTX) ? AxisType::X : AxisType::Y;
-                    axis_values[stick->type][axis_type] = SDL_GetGamepadAxis(controller->second, axis);
-                }
-                AxisType max_axis = (abs(axis_values[stick->type][static_cast<int>(AxisType::X)]) >= abs(axis_values[stick->type][static_cast<int>(AxisType::Y)])) ? AxisType::X : AxisType::Y;
-                if (abs(axis_values[stick->type][max_axis]) < BL::GAMEPAD_DEADZONE)
-                    continue;
-                
-                // Determine direction of stick movement
-                GamepadControl::Direction direction;
-                if (max_axis == AxisType::X) {
-                    if (axis_values[stick->type][static_cast<int>(AxisType::X)] < 0)
-                        direction = GamepadControl::Direction::XM;
-                    else
-                        direction = GamepadControl::Direction::XP;
-                }
-                else if (max_axis == AxisType::Y) {
-                    if (axis_values[stick->type][static_cast<int>(AxisType::Y)] < 0)
-                        direction = GamepadControl::Direction::YM;
-                    else
-                        direction = GamepadControl::Direction::YP;
-                }
+    int x = controller.axes[stick == GamepadControl::Type::LSTICK ? SDL_GAMEPAD_AXIS_LEFTX : SDL_GAMEPAD_AXIS_RIGHTX];
+    int y = controller.axes[stick == GamepadControl::Type::LSTICK ? SDL_GAMEPAD_AXIS_LEFTY : SDL_GAMEPAD_AXIS_RIGHTY];
+    bool x_max = abs(x) >= abs(y);
+    int max = x_max ? x : y;
+    int min = x_max ? y : x;
+    if (abs(max) < BL::GAMEPAD_DEADZONE)
+        return nullptr;
+
+    GamepadControl::Direction direction;
+    if (x_max)
+        direction = max < 0 ? GamepadControl::Direction::XM : GamepadControl::Direction::XP;
+    else
+        direction = max < 0 ? GamepadControl::Direction::YM : GamepadControl::Direction::YP;
+    GamepadControl *control = stick_controls[stick][direction];
+    if (control && abs(min) < abs((int) std::round((float) max * MAX_OPPOSING)))
+        return control;
+    return nullptr;
+}
 
-                // Save set selected axis if stick press is within range of a control
-                auto it = std::find_if(config.gamepad_controls.begin(),
-                            config.gamepad_controls.end(),
-                            [&](auto control){return stick->type == control.type && direction == control.direction;}
-                        );
-                if (it != config.gamepad_controls.end()) {
-                    AxisType min_axis = (max_axis == AxisType::X) ? AxisType::Y : AxisType::X;
-                    if (abs(axis_values[stick->type][min_axis]) < abs((int) std::round((float) axis_values[stick->type][max_axis] * MAX_OPPOSING)))
-                        selected_axis = &*it;
-                }
-            }
+// A control fires when the first controller presses it, and repeats while any controller holds it
+bool BL::Gamepad::press(GamepadControl *control, bool execute)
+{
+    if (control->holds++)
+        return false;
+    if (!execute)
+        return false;
+    BL::logger::debug("Gamepad {} detected", control->label);
+    control->repeat_time = SDL_GetTicks() + BL::GAMEPAD_REPEAT_DELAY;
+    launcher.execute_command(control->command);
+    return true;
+}
+
+void BL::Gamepad::release(GamepadControl *control)
+{
+    if (control->holds && !--control->holds)
+        control->repeat_time = 0;
+}
+
+void BL::Gamepad::release_all(Controller &controller)
+{
+    for (int i = 0; i < SDL_GAMEPAD_BUTTON_COUNT; i++) {
+        if (controller.buttons[i]) {
+            for (GamepadControl *control : button_controls[i])
+                release(control);
         }
     }
+    for (int i = 0; i < SDL_GAMEPAD_AXIS_COUNT; i++) {
+        if (controller.triggers[i]) {
+            for (GamepadControl *control : trigger_controls[i])
+                release(control);
+        }
+    }
+    for (GamepadControl *control : controller.sticks) {
+        if (control)
+            release(control);
+    }
+    controller = Controller(controller.gamepad);
+}
 
-
-    // Check each control
-    for (GamepadControl &control : config.gamepad_controls) {
-        if (control.type == GamepadControl::Type::LSTICK || control.type == GamepadControl::Type::RSTICK) {
-            if (&control == selected_axis) { // We already polled for the stick
-                control.repeat++;
-                selected_axis = nullptr;
+// Updates the input state from a gamepad event, returns true if a command was executed
+bool BL::Gamepad::handle_event(const SDL_Event &event, bool execute)
+{
+    bool ret = false;
+    switch (event.type) {
+        case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+        case SDL_EVENT_GAMEPAD_BUTTON_UP: {
+            auto it = controllers.find(event.gbutton.which);
+            if (it == controllers.end() || event.gbutton.button >= SDL_GAMEPAD_BUTTON_COUNT)
+                break;
+            bool down = event.type == SDL_EVENT_GAMEPAD_BUTTON_DOWN;
+            bool &pressed = it->second.buttons[event.gbutton.button];
+            if (pressed == down)
+                break;
+            pressed = down;
+            for (GamepadControl *control : button_controls[event.gbutton.button]) {
+                if (down)
+                    ret |= press(control, execute);
+                else
+                    release(control);
             }
-            else
-                control.repeat = 0;
+            break;
         }
 
-        // Poll buttons
-        else {
-            bool pressed = false;
-            for (auto [id, gamepad] : controllers) {
-                if ((control.type == GamepadControl::Type::BUTTON && SDL_GetGamepadButton(gamepad, (SDL_GamepadButton) control.index)) ||
-                (control.type == GamepadControl::Type::TRIGGER && SDL_GetGamepadAxis(gamepad, (SDL_GamepadAxis) control.index) > BL::GAMEPAD_DEADZONE)) {
-                    pressed = true;
+        case SDL_EVENT_GAMEPAD_AXIS_MOTION: {
+            auto it = controllers.find(event.gaxis.which);
+            if (it == controllers.end() || event.gaxis.axis >= SDL_GAMEPAD_AXIS_COUNT)
+                break;
+            Controller &controller = it->second;
+            controller.axes[event.gaxis.axis] = event.gaxis.value;
+
+            // Triggers
+            if (event.gaxis.axis == SDL_GAMEPAD_AXIS_LEFT_TRIGGER || event.gaxis.axis == SDL_GAMEPAD_AXIS_RIGHT_TRIGGER) {
+                bool down = event.gaxis.value > BL::GAMEPAD_DEADZONE;
+                bool &pressed = controller.triggers[event.gaxis.axis];
+                if (pressed == down)
                     break;
+                pressed = down;
+                for (GamepadControl *control : trigger_controls[event.gaxis.axis]) {
+                    if (down)
+                        ret |= press(control, execute);
+                    else
+                        release(control);
                 }
             }
-            control.repeat = pressed ? control.repeat + 1 : 0;
-        }
-
-        if (control.repeat == 1) {
-            BL::logger::debug("Gamepad {} detected", control.label);
-            ret = true;
-            launcher.execute_command(control.command);
 
-        }
-        else if (control.repeat == delay_period) {
-            launcher.execute_command(control.command);
-            control.repeat -= repeat_period;
+            // Sticks
+            else {
+                auto stick = (event.gaxis.axis == SDL_GAMEPAD_AXIS_LEFTX || event.gaxis.axis == SDL_GAMEPAD_AXIS_LEFTY) 
+                             ? GamepadControl::Type::LSTICK 
+                             : GamepadControl::Type::RSTICK;
+                GamepadControl *control = get_stick_control(controller, stick);
+                GamepadControl *&selected = controller.sticks[stick];
+                if (control == selected)
+                    break;
+                if (selected)
+                    release(selected);
+                selected = control;
+                if (control)
+                    ret |= press(control, execute);
+            }
+            break;
         }
     }
     return ret;
 }
+
+// Fires the repeats of held controls, at the same rate regardless of the frame rate
+bool BL::Gamepad::poll()
+{
+    bool ret = false;
+    Uint64 ticks = SDL_GetTicks();
+    for (GamepadControl &control : config.gamepad_controls) {
+        if (!control.repeat_time || ticks < control.repeat_time)
+            continue;
+        launcher.execute_command(control.command);
+        control.repeat_time += BL::GAMEPAD_REPEAT_INTERVAL;
+        if (control.repeat_time <= ticks)
+            control.repeat_time = ticks + BL::GAMEPAD_REPEAT_INTERVAL;
+        ret = true;
+    }
+    return ret;
+}
+
+// Milliseconds until the next repeat of a held control, -1 if nothing is held
+int BL::Gamepad::get_wait_timeout() const
+{
+    Uint64 ticks = SDL_GetTicks();
+    int timeout = -1;
+    for (const GamepadControl &control : config.gamepad_controls) {
+        if (!control.repeat_time)
+            continue;
+        int t = control.repeat_time > ticks ? static_cast<int>(control.repeat_time - ticks) : 0;
+        timeout = timeout < 0 ? t : std::min(timeout, t);
+    }
+    return timeout;
+}
@@ -14,42 +14,45 @@ namespace BL {
     class Launcher;
     class Gamepad {
         private:
+            // Last known input of one controller, updated from SDL gamepad events
             struct Controller {
-                SDL_Gamepad *gc = nullptr;
-                int device_index;
-                bool connected = false;
+                SDL_Gamepad *gamepad;
+                std::array<Sint16, SDL_GAMEPAD_AXIS_COUNT> axes{};
+                std::array<bool, SDL_GAMEPAD_AXIS_COUNT> triggers{};
+                std::array<bool, SDL_GAMEPAD_BUTTON_COUNT> buttons{};
+                std::array<GamepadControl*, 2> sticks{}; // control selected by each stick
 
-                Controller(int device_index) : device_index(device_index) { connect(true); }
-                void connect(bool raise_error);
-                void disconnect();
-            };
-
-            enum AxisType{
-                X,
-                Y,
+                Controller(SDL_Gamepad *gamepad): gamepad(gamepad) {}
             };
 
             Launcher &launcher;
-            std::map<int, SDL_Gamepad*> controllers;
-            std::array<std::array<int, 2>, 2> axis_values;
-            GamepadControl *selected_axis = nullptr;
+            std::map<int, Controller> controllers;
+
+            // Controls by the input that triggers them
+            std::array<std::vector<GamepadControl*>, SDL_GAMEPAD_BUTTON_COUNT> button_controls;
+            std::array<std::vector<GamepadControl*>, SDL_GAMEPAD_AXIS_COUNT> trigger_controls;
+            std::array<std::array<GamepadControl*, 4>, 2> stick_controls{};
 #ifndef _WIN32 
             constexpr static
 #endif
             float MAX_OPPOSING = std::sin((GAMEPAD_AXIS_RANGE / 2.f) * PI / 180.f);
 
-            int delay_period;
-            int repeat_period;
+            GamepadControl* get_stick_control(const Controller &controller, GamepadControl::Type stick) const;
+            bool press(GamepadControl *control, bool execute);
+            void release(GamepadControl *control);
+            void release_all(Controller &controller);
 
         public:
             bool connected;
 
-            Gamepad(int refresh_period, const std::string &gamepad_mappings_file, Launcher &launcher);
+            Gamepad(const std::string &gamepad_mappings_file, Launcher &launcher);
             ~Gamepad();
             void add(int id);
             void remove(int id);
             void connect();
             void disconnect();
+            bool handle_event(const SDL_Event &event, bool execute);
             bool poll();
+            int get_wait_timeout() const;
     };
 }
@@ -5,12 +5,14 @@
 
 #include <SDL3/SDL.h>
 
+#include "command.hpp"
+
 namespace BL {
     class Hotkey {
     public:
         SDL_Keycode keycode;
-        std::string command;
-        Hotkey(SDL_Keycode keycode, std::string_view command) : keycode(keycode), command(command) {}
+        Command command;
+        Hotkey(SDL_Keycode keycode, std::string_view command) : keycode(keycode), command(std::string(command)) {}
         ~Hotkey() = default;
     };
 
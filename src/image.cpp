@@ -1,18 +1,22 @@
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
 #include "logger.hpp"
 #include <lconfig.h>
 #include "image.hpp"
+#include "blur.hpp"
 #include "util.hpp"
+#include "profiler.hpp"
 #define NANOSVG_IMPLEMENTATION
 #include "external/nanosvg.h"
 #define NANOSVGRAST_IMPLEMENTATION
 #include "external/nanosvgrast.h"
-#include "external/fast_gaussian_blur_template.h"
 
-SDL_Surface* BL::load_surface(std::string &file)
+extern BL::Profiler profiler;
+
+SDL_Surface* BL::load_surface(const std::string &file, int w, int h)
 {
     SDL_Surface *img = nullptr;
     SDL_Surface *out = nullptr;
@@ -21,6 +25,7 @@ SDL_Surface* BL::load_surface(std::string &file)
         BL::logger::error("Could not load image from {} (SDL Error: {})", file, SDL_GetError());
         return out;
     }
+    profiler.add_decoded(static_cast<size_t>(img->pitch) * img->h);
 
     // Convert the loaded surface if different pixel format
     if (img->format != SDL_PIXELFORMAT_RGBA32) {
@@ -33,6 +38,106 @@ SDL_Surface* BL::load_surface(std::string &file)
     else
         out = img;
 
+    if (w > 0 && h > 0)
+        out = resize_surface(out, w, h);
+    return out;
+}
+
+namespace BL {
+    // Source pixel i covers [i, i + 1), output pixel o covers [o * scale, (o + 1) * scale),
+    // when downscaling every source pixel overlaps at most two output pixels
+    struct AreaWeight {
+        int o;
+        float w0;
+        float w1;
+    };
+
+    std::vector<AreaWeight> area_weights(int in_size, int out_size)
+    {
+        std::vector<AreaWeight> weights(in_size);
+        float scale = static_cast<float>(in_size) / static_cast<float>(out_size);
+        float inv_scale = 1.f / scale;
+        for (int i = 0; i < in_size; i++) {
+            int o = std::min(static_cast<int>(static_cast<float>(i) * inv_scale), out_size - 1);
+            float boundary = static_cast<float>(o + 1) * scale;
+            float w0 = std::clamp(boundary - static_cast<float>(i), 0.f, 1.f);
+            if (o == out_size - 1)
+                w0 = 1.f;
+            weights[i] = {o, w0 * inv_scale, (1.f - w0) * inv_scale};
+        }
+        return weights;
+    }
+}
+
+// Area-average downscale, colors are weighted by alpha so transparent pixels don't bleed into edges.
+// Takes ownership of the input, surfaces that are already small enough are returned as is
+SDL_Surface* BL::resize_surface(SDL_Surface *in, int w, int h)
+{
+    if (!in || (in->w <= w && in->h <= h) || in->format != SDL_PIXELFORMAT_RGBA32)
+        return in;
+    w = std::min(w, in->w);
+    h = std::min(h, in->h);
+
+    std::vector<BL::AreaWeight> x_weights = BL::area_weights(in->w, w);
+    std::vector<BL::AreaWeight> y_weights = BL::area_weights(in->h, h);
+    std::vector<float> row(4 * (w + 1));
+    std::vector<float> acc(4 * w * (h + 1), 0.f);
+    for (int y = 0; y < in->h; y++) {
+
+        // Horizontal pass on premultiplied colors
+        std::fill(row.begin(), row.end(), 0.f);
+        const Uint8 *src = static_cast<const Uint8*>(in->pixels) + y * in->pitch;
+        for (int x = 0; x < in->w; x++) {
+            const BL::AreaWeight &xw = x_weights[x];
+            float a = static_cast<float>(src[4*x + 3]);
+            float p[4] = {
+                static_cast<float>(src[4*x]) * a,
+                static_cast<float>(src[4*x + 1]) * a,
+                static_cast<float>(src[4*x + 2]) * a,
+                a
+            };
+            float *dst = row.data() + 4 * xw.o;
+            for (int c = 0; c < 4; c++) {
+                dst[c] += p[c] * xw.w0;
+                dst[c + 4] += p[c] * xw.w1;
+            }
+        }
+
+        // Vertical pass, accumulate the row into the output rows it overlaps
+        const BL::AreaWeight &yw = y_weights[y];
+        float *dst0 = acc.data() + 4 * w * yw.o;
+        float *dst1 = dst0 + 4 * w;
+        for (int i = 0; i < 4 * w; i++) {
+            dst0[i] += row[i] * yw.w0;
+            dst1[i] += row[i] * yw.w1;
+        }
+    }
+
+    SDL_Surface *out = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+    for (int y = 0; y < h; y++) {
+        const float *src = acc.data() + 4 * w * y;
+        Uint8 *dst = static_cast<Uint8*>(out->pixels) + y * out->pitch;
+        for (int x = 0; x < w; x++) {
+            float a = src[4*x + 3];
+            float inv_a = (a > 0.f) ? 1.f / a : 0.f;
+            for (int c = 0; c < 3; c++)
+                dst[4*x + c] = static_cast<Uint8>(std::clamp(src[4*x + c] * inv_a + 0.5f, 0.f, 255.f));
+            dst[4*x + 3] = static_cast<Uint8>(std::clamp(a + 0.5f, 0.f, 255.f));
+        }
+    }
+    BL::free_surface(in);
+    return out;
+}
+
+// Creates a pixel-for-pixel copy of a surface without touching the blit state of the source
+SDL_Surface* BL::copy_surface(const SDL_Surface &in)
+{
+    SDL_Surface *out = SDL_CreateSurface(in.w, in.h, in.format);
+    auto src = static_cast<const Uint8*>(in.pixels);
+    auto dst = static_cast<Uint8*>(out->pixels);
+    int row_size = std::min(in.pitch, out->pitch);
+    for (int y = 0; y < in.h; y++)
+        memcpy(dst + y * out->pitch, src + y * in.pitch, row_size);
     return out;
 }
 
@@ -57,7 +162,9 @@ SDL_Surface* BL::SVGRasterizer::rasterize_svg_from_file(const std::string &file,
         BL::logger::error("Could not load SVG");
         return nullptr;
     }
-    return rasterize_svg_image(image, w, h);
+    SDL_Surface *surface = rasterize_svg_image(image, w, h);
+    nsvgDelete(image);
+    return surface;
 }
 
 // A function to rasterize an SVG from an existing text buffer
@@ -68,7 +175,9 @@ SDL_Surface* BL::SVGRasterizer::rasterize_svg(const std::string &buffer, int w,
         BL::logger::error("Could not parse SVG");
         return nullptr;
     }
-    return rasterize_svg_image(image, w, h);
+    SDL_Surface *surface = rasterize_svg_image(image, w, h);
+    nsvgDelete(image);
+    return surface;
 }
 
 SDL_Surface* BL::SVGRasterizer::rasterize_svg_image(NSVGimage *image, int w, int h)
@@ -108,6 +217,7 @@ SDL_Surface* BL::SVGRasterizer::rasterize_svg_image(NSVGimage *image, int w, int
     }
 
     // Rasterize image
+    profiler.add_decoded(static_cast<size_t>(pitch) * height);
     nsvgRasterize(rasterizer, image, 0, 0, scale, pixel_buffer, width, height, pitch);
     SDL_Surface *surface = SDL_CreateSurfaceFrom(
                                width,
@@ -116,7 +226,6 @@ SDL_Surface* BL::SVGRasterizer::rasterize_svg_image(NSVGimage *image, int w, int
                                pixel_buffer,
                                pitch
                            );
-    nsvgDelete(image);
     return surface;
 }
 
@@ -132,6 +241,94 @@ void BL::SVGRasterizer::delete_image(NSVGimage *image)
 }
 
 
+namespace BL {
+    // Same rounding as the SDL blitter, so the result matches blending the RGBA surfaces
+    inline Uint8 mul_div_255(Uint32 a, Uint32 b)
+    {
+        Uint32 x = a * b + 1;
+        x += x >> 8;
+        return static_cast<Uint8>(x >> 8);
+    }
+
+    // Expands an alpha buffer into a black RGBA shadow surface
+    SDL_Surface* expand_alpha(const std::vector<Uint8> &alpha, int w, int h)
+    {
+        SDL_Surface *shadow = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+        for (int y = 0; y < h; y++) {
+            Uint8 *row = static_cast<Uint8*>(shadow->pixels) + y * shadow->pitch;
+            for (int x = 0; x < w; x++) {
+                row[4*x] = 0;
+                row[4*x + 1] = 0;
+                row[4*x + 2] = 0;
+                row[4*x + 3] = alpha[y * w + x];
+            }
+        }
+        return shadow;
+    }
+
+    constexpr int SHADOW_SAMPLES = 8;
+    constexpr float SQRT_HALF = 0.70710678f;
+    constexpr float INV_SQRT_2PI = 0.39894228f;
+
+    // Fraction of a Gaussian with standard deviation sigma centered at x that lies within [a, b]
+    inline float gaussian_coverage(float x, float a, float b, float sigma)
+    {
+        if (sigma <= 0.f)
+            return (x >= a && x < b) ? 1.f : 0.f;
+        float k = SQRT_HALF / sigma;
+        return 0.5f * (std::erf((b - x) * k) - std::erf((a - x) * k));
+    }
+
+    // Blurred rounded rectangle centered at the origin, the horizontal integral is exact
+    // and the vertical one is sampled over +-3 sigma
+    float rounded_rect_coverage(float x, float y, float half_w, float half_h, float radius, float sigma)
+    {
+        auto row_coverage = [&](float y) {
+            float delta = std::min(half_h - radius - std::abs(y), 0.f);
+            float curved = half_w - radius + std::sqrt(std::max(0.f, radius * radius - delta * delta));
+            return gaussian_coverage(x, -curved, curved, sigma);
+        };
+        if (sigma <= 0.f)
+            return std::abs(y) < half_h ? row_coverage(y) : 0.f;
+
+        float start = std::clamp(-3.f * sigma, y - half_h, y + half_h);
+        float end = std::clamp(3.f * sigma, y - half_h, y + half_h);
+        float step = (end - start) / static_cast<float>(SHADOW_SAMPLES);
+        float value = 0.f;
+        for (int i = 0; i < SHADOW_SAMPLES; i++) {
+            float t = start + step * (static_cast<float>(i) + 0.5f);
+            float gaussian = INV_SQRT_2PI / sigma * std::exp(-0.5f * t * t / (sigma * sigma));
+            value += row_coverage(y - t) * gaussian * step;
+        }
+        return value;
+    }
+}
+
+// Alpha blends src onto dst at (x, y) without going through the SDL blitter, which keeps
+// per-surface blit state, so the same source can be blended from several threads at once
+void BL::blend_surface(const SDL_Surface &src, SDL_Surface &dst, int x, int y)
+{
+    int x0 = std::max(0, -x);
+    int y0 = std::max(0, -y);
+    int x1 = std::min(src.w, dst.w - x);
+    int y1 = std::min(src.h, dst.h - y);
+    for (int sy = y0; sy < y1; sy++) {
+        auto in = static_cast<const Uint8*>(src.pixels) + sy * src.pitch;
+        auto out = static_cast<Uint8*>(dst.pixels) + (sy + y) * dst.pitch + 4 * x;
+        for (int sx = x0; sx < x1; sx++) {
+            const Uint8 *s = in + 4 * sx;
+            Uint8 *d = out + 4 * sx;
+            Uint8 a = s[3];
+            Uint8 inv_a = 255 - a;
+            for (int c = 0; c < 3; c++)
+                d[c] = BL::mul_div_255(s[c], a) + BL::mul_div_255(d[c], inv_a);
+            d[3] = a + BL::mul_div_255(d[3], inv_a);
+        }
+    }
+}
+
+// Shadows are always black, so the whole pipeline works on the alpha channel only
+// and the RGBA shadow surface is only written once at the end
 SDL_Surface* BL::create_shadow(SDL_Surface *in, const std::vector<BoxShadow> &box_shadows, int s_offset)
 {
     float max_radius = 0.0f;
@@ -141,79 +338,98 @@ SDL_Surface* BL::create_shadow(SDL_Surface *in, const std::vector<BoxShadow> &bo
     );
     int padding = 2 * static_cast<int>(ceil(max_radius));
 
-    SDL_Color mod;
-    SDL_GetSurfaceColorMod(in, &mod.r, &mod.g, &mod.b);
-    SDL_GetSurfaceAlphaMod(in, &mod.a);
-    SDL_SetSurfaceColorMod(in, 0, 0, 0);
-
-    // Set up shadow
-    SDL_Surface *shadow = SDL_CreateSurface(
-                              in->w + 2*s_offset, 
-                              in->h + 2*s_offset, 
-                              SDL_PIXELFORMAT_RGBA32
-                          );
-    Uint32 color = SDL_MapSurfaceRGBA(shadow, 0, 0, 0, 0);
-    SDL_FillSurfaceRect(shadow, nullptr, color);
-
-    // Set up alpha mask
-    SDL_Surface *alpha_mask = SDL_CreateSurface(
-                                  in->w + 2*(padding + s_offset), 
-                                  in->h + 2*(padding + s_offset), 
-                                  SDL_PIXELFORMAT_RGBA32
-                              );
-    SDL_Rect alpha_mask_rect = {padding + s_offset, padding + s_offset, in->w, in->h};
-    
-    Uint8 *in_pixels;
-    Uint8 *out_pixels;
-    Uint8 *out_pixels0; // fast guassian blur swaps the address of the in/out pointers, need to rememeber it
-    SDL_Surface *tmp;
-    SDL_Rect src_rect;
-    SDL_Rect dst_rect;
-    int w, h;
+    SDL_Surface *src = in;
+    if (in->format != SDL_PIXELFORMAT_RGBA32)
+        src = SDL_ConvertSurface(in, SDL_PIXELFORMAT_RGBA32);
+
+    // Extract the alpha mask once
+    int shadow_w = in->w + 2*s_offset;
+    int shadow_h = in->h + 2*s_offset;
+    int mask_w = shadow_w + 2*padding;
+    int mask_h = shadow_h + 2*padding;
+    int mask_offset = padding + s_offset;
+    std::vector<Uint8> alpha(in->w * in->h);
+    for (int y = 0; y < in->h; y++) {
+        auto row = static_cast<const Uint8*>(src->pixels) + y * src->pitch;
+        for (int x = 0; x < in->w; x++)
+            alpha[y * in->w + x] = row[4*x + 3];
+    }
+    if (src != in)
+        BL::free_surface(src);
+
+    // Scratch buffers shared by all box shadows
+    std::vector<Uint8> mask(mask_w * mask_h);
+    std::vector<Uint8> scratch(mask_w * mask_h);
+    std::vector<Uint8> shadow_alpha(shadow_w * shadow_h, 0);
     for (const BoxShadow &bs : box_shadows) {
 
         // Make alpha mask
-        SDL_FillSurfaceRect(alpha_mask, nullptr, color);
-        SDL_SetSurfaceAlphaMod(in, bs.alpha);
-        SDL_BlitSurface(in, nullptr, alpha_mask, &alpha_mask_rect);
+        std::fill(mask.begin(), mask.end(), 0);
+        for (int y = 0; y < in->h; y++) {
+            Uint8 *row = mask.data() + (y + mask_offset) * mask_w + mask_offset;
+            for (int x = 0; x < in->w; x++)
+                row[x] = BL::mul_div_255(alpha[y * in->w + x], bs.alpha);
+        }
 
         // Blur alpha mask
-        in_pixels = static_cast<Uint8*>(alpha_mask->pixels);
-        out_pixels = static_cast<Uint8*>(malloc(alpha_mask->w*alpha_mask->h*4));
-        out_pixels0 = out_pixels;
-        fast_gaussian_blur<Uint8>(in_pixels, out_pixels, alpha_mask->w, alpha_mask->h, 4, bs.radius);
-        tmp = SDL_CreateSurfaceFrom(
-                  alpha_mask->w,
-                  alpha_mask->h,
-                  SDL_PIXELFORMAT_RGBA32,
-                  out_pixels,
-                  alpha_mask->w*4
-              );
-
-        // Composit onto shadow surface
-        w = alpha_mask->w - 2*padding - abs(bs.x_offset);
-        h = alpha_mask->w - 2*padding - abs(bs.y_offset);
-        src_rect = {
-            (bs.x_offset >= 0) ? padding : padding + static_cast<int>(bs.x_offset), 
-            (bs.y_offset >= 0) ? padding : padding + static_cast<int>(bs.y_offset), 
-            w,
-            h
-        };
-        dst_rect = {
-            (bs.x_offset > 0) ? static_cast<int>(bs.x_offset) : 0,
-            (bs.y_offset > 0) ? static_cast<int>(bs.y_offset) : 0,
-            w,
-            h
-        };
-        SDL_BlitSurface(tmp, &src_rect, shadow, &dst_rect);
-        free(out_pixels0);
-        SDL_DestroySurface(tmp);
+        BL::blur_alpha(mask.data(), scratch.data(), mask_w, mask_h, bs.radius);
+
+        // Composit onto shadow alpha
+        int x_offset = static_cast<int>(bs.x_offset);
+        int y_offset = static_cast<int>(bs.y_offset);
+        int w = shadow_w - abs(x_offset);
+        int h = shadow_h - abs(y_offset);
+        int src_x = (x_offset >= 0) ? padding : padding + x_offset;
+        int src_y = (y_offset >= 0) ? padding : padding + y_offset;
+        int dst_x = (x_offset > 0) ? x_offset : 0;
+        int dst_y = (y_offset > 0) ? y_offset : 0;
+        for (int y = 0; y < h; y++) {
+            const Uint8 *src_row = mask.data() + (y + src_y) * mask_w + src_x;
+            Uint8 *dst_row = shadow_alpha.data() + (y + dst_y) * shadow_w + dst_x;
+            for (int x = 0; x < w; x++)
+                dst_row[x] = src_row[x] + BL::mul_div_255(dst_row[x], 255 - src_row[x]);
+        }
     }
 
-    BL::free_surface(alpha_mask);
+    return BL::expand_alpha(shadow_alpha, shadow_w, shadow_h);
+}
+
+// Closed form shadows for (rounded) rectangles, a blurred rectangle is separable into two
+// erf ranges, rounded corners only need the vertical integral to be sampled
+SDL_Surface* BL::create_shadow(const RoundedRect &rect, const std::vector<BoxShadow> &box_shadows, int s_offset)
+{
+    int shadow_w = rect.w + 2*s_offset;
+    int shadow_h = rect.h + 2*s_offset;
+    float half_w = static_cast<float>(rect.w) / 2.f;
+    float half_h = static_cast<float>(rect.h) / 2.f;
+    float radius = std::clamp(rect.radius, 0.f, std::min(half_w, half_h));
 
-    SDL_SetSurfaceColorMod(in, mod.r, mod.g, mod.b);
-    SDL_SetSurfaceAlphaMod(in, mod.a);
+    std::vector<Uint8> shadow_alpha(shadow_w * shadow_h, 0);
+    std::vector<float> x_coverage(shadow_w);
+    std::vector<float> y_coverage(shadow_h);
+    for (const BoxShadow &bs : box_shadows) {
+        float cx = static_cast<float>(s_offset) + half_w + static_cast<float>(static_cast<int>(bs.x_offset));
+        float cy = static_cast<float>(s_offset) + half_h + static_cast<float>(static_cast<int>(bs.y_offset));
+        float alpha = static_cast<float>(bs.alpha);
+        if (radius == 0.f) {
+            for (int x = 0; x < shadow_w; x++)
+                x_coverage[x] = BL::gaussian_coverage(static_cast<float>(x) + 0.5f - cx, -half_w, half_w, bs.radius);
+            for (int y = 0; y < shadow_h; y++)
+                y_coverage[y] = BL::gaussian_coverage(static_cast<float>(y) + 0.5f - cy, -half_h, half_h, bs.radius);
+        }
+
+        for (int y = 0; y < shadow_h; y++) {
+            Uint8 *row = shadow_alpha.data() + y * shadow_w;
+            float py = static_cast<float>(y) + 0.5f - cy;
+            for (int x = 0; x < shadow_w; x++) {
+                float coverage = (radius == 0.f)
+                                 ? x_coverage[x] * y_coverage[y]
+                                 : BL::rounded_rect_coverage(static_cast<float>(x) + 0.5f - cx, py, half_w, half_h, radius, bs.radius);
+                Uint8 a = static_cast<Uint8>(std::clamp(std::round(alpha * coverage), 0.f, 255.f));
+                row[x] = a + BL::mul_div_255(row[x], 255 - a);
+            }
+        }
+    }
 
-    return shadow;
+    return BL::expand_alpha(shadow_alpha, shadow_w, shadow_h);
 }
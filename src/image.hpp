@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include <SDL3/SDL.h>
 
@@ -49,6 +50,21 @@ namespace BL {
         void delete_image(NSVGimage *image);
     };
 
-    SDL_Surface *load_surface(std::string &file);
+    SDL_Surface *load_surface(const std::string &file, int w = -1, int h = -1);
+    SDL_Surface *resize_surface(SDL_Surface *in, int w, int h);
+    SDL_Surface *copy_surface(const SDL_Surface &in);
+    void blend_surface(const SDL_Surface &src, SDL_Surface &dst, int x, int y);
+    // Known shadow caster shapes that can be evaluated in closed form
+    struct RoundedRect {
+        int w;
+        int h;
+        float radius;
+
+        // SVG clamps rx and ry separately, so a radius above half of either side gives elliptical corners
+        bool has_closed_form() const { return radius >= 0.f && 2.f * radius <= static_cast<float>(std::min(w, h)); }
+    };
+
+    // Blurs the alpha mask of the surface, the fallback for shapes without a closed form
     SDL_Surface* create_shadow(SDL_Surface *in, const std::vector<BoxShadow> &box_shadows, int s_offset);
+    SDL_Surface* create_shadow(const RoundedRect &rect, const std::vector<BoxShadow> &box_shadows, int s_offset);
 }
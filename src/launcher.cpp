@@ -0,0 +1,532 @@
+#include <string>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#include <exception>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "logger.hpp"
+
+#include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
+
+#include <lconfig.h>
+#include "main.hpp"
+#include "gamepad.hpp"
+#include "layout.hpp"
+#include "hotkey.hpp"
+#include "renderer.hpp"
+#include "renderer_sdl.hpp"
+#include "sound.hpp"
+#include "util.hpp"
+#include "config.hpp"
+#include "profiler.hpp"
+#include "frame_stats.hpp"
+#include "stats_overlay.hpp"
+#include "platform/platform.hpp"
+
+extern BL::Config config;
+extern BL::Profiler profiler;
+extern BL::FrameStats frame_stats;
+
+namespace BL {
+    constexpr std::array<std::string_view, 5> NAVIGATION_COMMANDS = {":left", ":right", ":up", ":down", ":select"};
+}
+
+BL::Launcher::Launcher(const std::string &layout_path)
+{
+    init_display();
+    layout = new BL::Layout(layout_path, render_w, render_h, *this);
+    layout->load_surfaces();
+
+    create_window();
+
+    BL::logger::debug("Creating renderer...");
+    {
+        BL::ProfileScope scope("renderer");
+        renderer = new BL::RendererSDL(*window);
+    }
+#ifdef DEBUG
+    if (config.render_w && config.render_h)
+        renderer->set_render_scale(static_cast<float>(dm->w)/ static_cast<float>(render_w), static_cast<float>(dm->h)/static_cast<float>(render_h));
+#endif
+    if (letterbox)
+        renderer->set_logical_representation(render_w, render_h);
+    layout->load_textures(*renderer);
+    if (config.sound_enabled) {
+        BL::ProfileScope scope("sound");
+        try {
+            sound = new BL::Sound();
+        }
+        catch(...) {
+            delete sound;
+            sound = nullptr;
+        }
+    }
+    if (config.gamepad_enabled) {
+        BL::ProfileScope scope("gamepad");
+        try {
+            gamepad = new BL::Gamepad(config.gamepad_mappings_file, *this);
+        }
+        catch(...) {
+            delete gamepad;
+            gamepad = nullptr;
+        }
+    }
+
+#ifdef _WIN32
+    if (has_exit_hotkey()) {
+        register_exit_hotkey();
+        SDL_SetWindowsMessageHook(&BL::Launcher::process_msg, nullptr);
+    }
+#endif
+}
+
+BL::Launcher::~Launcher()
+{
+    profiler.write();
+    frame_stats.log_summary();
+#ifdef COUNT_ALLOCATIONS
+    frame_stats.print_allocation_histogram();
+#endif
+    delete stats_overlay;
+    delete layout;
+    delete renderer;
+    delete gamepad;
+    delete sound;
+    if (window)
+        SDL_DestroyWindow(window);
+
+    TTF_Quit();
+    SDL_Quit();
+}
+
+#ifdef _WIN32
+bool BL::Launcher::process_msg(void* userdata, MSG *msg)
+{
+    if (msg->message == WM_HOTKEY)
+        return !close_foreground_window();
+    return true;
+}
+
+#endif
+
+void BL::Launcher::play_click()
+{
+    if (sound)
+        sound->play_click();
+}
+
+void BL::Launcher::play_select()
+{
+    if (sound)
+        sound->play_select();
+}
+
+void BL::Launcher::init_display()
+{
+#ifdef __unix__
+    SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR, "0");
+#endif
+
+    // Initialize SDL
+    if (!SDL_Init(SDL_INIT_VIDEO))
+        BL::logger::critical("Could not initialize SDL (SDL Error: {})", SDL_GetError());
+
+    int display_count;
+    SDL_DisplayID *displays = SDL_GetDisplays(&display_count);
+    if (!display_count)
+        BL::logger::critical("Could not find any valid display");
+    SDL_DisplayID display_id = displays[0];
+    SDL_free(displays);
+     
+    if (!(dm = SDL_GetDesktopDisplayMode(display_id)))
+        BL::logger::critical("Could not get desktop display mode (SDL Error: {})", SDL_GetError());
+#ifdef DEBUG
+    if (config.render_w && config.render_h) {
+        render_w = config.render_w;
+        render_h = config.render_h;
+    }
+    else {
+        render_w = dm->w;
+        render_h = dm->h;
+    }
+#else
+    render_w = dm->w;
+    render_h = dm->h;
+#endif
+
+    // Force 16:9 aspect ratio
+    float aspect_ratio = static_cast<float>(render_w) / static_cast<float>(render_h);
+    if (aspect_ratio > DISPLAY_ASPECT_RATIO + DISPLAY_ASPECT_RATIO_TOLERANCE) {
+        render_w = static_cast<int>(std::round(static_cast<float>(render_h) * DISPLAY_ASPECT_RATIO));
+        letterbox = true;
+    }
+    else if (aspect_ratio < DISPLAY_ASPECT_RATIO - DISPLAY_ASPECT_RATIO_TOLERANCE) {
+        render_h = static_cast<int>(std::round(static_cast<float>(render_w) / DISPLAY_ASPECT_RATIO));
+        letterbox = true;
+    }
+
+    // Initialize SDL_ttf
+    if (!TTF_Init())
+        BL::logger::critical("Could not initialize SDL_ttf (SDL Error: {})", SDL_GetError());
+
+    BL::logger::debug("Successfully initialized display");
+}
+
+void BL::Launcher::create_window()
+{
+    BL::logger::debug("Creating window...");
+    window = SDL_CreateWindow(PROJECT_NAME,
+                 dm->w,
+                 dm->h,
+                 SDL_WINDOW_FULLSCREEN 
+             );
+    if (!window)
+        BL::logger::critical("Could not create window (SDL Error: {})", SDL_GetError());
+    BL::logger::debug("Sucessfully created window");
+#ifdef _WIN32
+    set_hwnd(*window);
+#endif
+    SDL_HideCursor();
+
+    if (config.debug)
+        debug_display();
+}
+
+void BL::Launcher::debug_display()
+{
+    BL::logger::debug("Video Information:");
+    BL::logger::debug("  Resolution:   {}x{}", dm->w, dm->h);
+    BL::logger::debug("  Refresh Rate: {} Hz", dm->refresh_rate);
+    BL::logger::debug("  Driver:       {}", SDL_GetCurrentVideoDriver());
+}
+
+// Main program loop
+int BL::Launcher::run()
+{
+    ticks.main = ticks.last_input = SDL_GetTicks();
+    bool first_frame = true;
+
+    BL::logger::debug("");
+    BL::logger::debug("Begin main loop");
+    while(!quit) {
+        update();
+        process_events();
+
+        if (state.application_launching && 
+        ticks.main - ticks.application_launch > APPLICATION_TIMEOUT) {
+            state.application_launching = false;
+        }
+        if (state.application_running)
+            wait_for_application();
+
+        // Identical frames aren't redrawn, the loop sleeps until there is input or the layout changes
+        else if (config.render_on_demand && !layout->needs_redraw() && !(stats_overlay && stats_overlay->is_visible())) {
+            frame_stats.pause();
+            wait_for_event();
+        }
+        else {
+            draw();
+            present();
+            frame_stats.end_frame();
+            if (first_frame) {
+                BL::logger::debug("Time to first frame: {} ms", SDL_GetTicks());
+                profiler.set_first_frame();
+                first_frame = false;
+            }
+            if (profiler.is_enabled() && !layout->is_loading())
+                profiler.write();
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// Handles the pending SDL events and fires the gamepad controls that are held down
+void BL::Launcher::process_events()
+{
+    SDL_Event event;
+    Uint64 events_begin = SDL_GetTicksNS();
+    Uint32 last_input = ticks.last_input;
+    while(SDL_PollEvent(&event)) {
+        // Everything but vertical moves runs after the moves queued before it
+        if (pending_move.steps && !(event.type == SDL_EVENT_KEY_DOWN && (event.key.key == SDLK_DOWN || event.key.key == SDLK_UP)))
+            flush_moves();
+
+        switch(event.type) {
+            case SDL_EVENT_QUIT:
+                quit = true;
+                break;
+
+            case SDL_EVENT_KEY_DOWN:
+                if (!state.application_launching) {
+                    if (event.key.key == SDLK_DOWN || event.key.key == SDLK_UP)
+                        queue_move(event.key.key);
+                    else if (event.key.key == SDLK_LEFT)
+                        layout->move_left();
+                    else if (event.key.key == SDLK_RIGHT)
+                        layout->move_right();
+                    else if (event.key.key == SDLK_RETURN)
+                        layout->select();
+
+                    // Check hotkeys
+                    else {
+                        for (Hotkey &hotkey : config.hotkey_list) {
+                            if (hotkey.keycode == event.key.key) {
+                                execute_command(hotkey.command);
+                                break;
+                            }
+                        }
+                    }
+                    ticks.last_input = ticks.main;
+                }
+                break;
+
+            case SDL_EVENT_JOYSTICK_ADDED:
+                if (!gamepad)
+                    break;
+                if (SDL_IsGamepad(event.jdevice.which) == true) {
+                    if (config.debug) {
+                        BL::logger::debug("Detected gamepad '{}' at device index {}",
+                            SDL_GetGamepadNameForID(event.jdevice.which),
+                            event.jdevice.which
+                        );
+                    }
+                    gamepad->add(event.jdevice.which);
+                }
+                else if (config.debug)
+                    BL::logger::debug("Unrecognized joystick detected at device index {}", event.jdevice.which);
+                break;
+
+            // Buttons without a control still count as input for the screensaver
+            case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+            case SDL_EVENT_GAMEPAD_BUTTON_UP:
+            case SDL_EVENT_GAMEPAD_AXIS_MOTION:
+                if (gamepad && (gamepad->handle_event(event, !state.application_launching) ||
+                (event.type == SDL_EVENT_GAMEPAD_BUTTON_DOWN && !state.application_launching)))
+                    ticks.last_input = ticks.main;
+                break;
+
+            case SDL_EVENT_JOYSTICK_REMOVED:
+                BL::logger::debug("Device {} disconnected", event.jdevice.which);
+                if (gamepad)
+                    gamepad->remove(event.jdevice.which);
+                break;
+
+            case SDL_EVENT_WINDOW_FOCUS_LOST:
+                BL::logger::debug("Lost window focus");
+                if (state.application_launching) {
+                    pre_launch();
+                    state.application_launching = false;
+                    state.application_running = true;
+                }
+                break;
+
+            case SDL_EVENT_WINDOW_FOCUS_GAINED:
+                BL::logger::debug("Gained window focus");
+                if (state.application_running) {
+                    post_launch();
+                    state.application_running = false;
+                }
+                break;
+            case SDL_EVENT_MOUSE_BUTTON_DOWN:
+                ticks.last_input = ticks.main;
+                if (config.mouse_select && event.button.button == SDL_BUTTON_LEFT)
+                    layout->select();
+                break;
+
+            case SDL_EVENT_MOUSE_MOTION:
+                ticks.last_input = ticks.main;
+                break;
+
+            // Damaged or resized window contents aren't repainted by anything but a new frame
+            case SDL_EVENT_WINDOW_EXPOSED:
+            case SDL_EVENT_WINDOW_RESTORED:
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+                layout->request_redraw();
+                break;
+
+            case SDL_EVENT_RENDER_TARGETS_RESET:
+                BL::logger::debug("Render targets were reset");
+                layout->invalidate_layers();
+                break;
+        }
+    }
+    flush_moves();
+    frame_stats.add_stage(BL::FrameStats::EVENTS, events_begin);
+
+    // Children that exited are reaped, the launch is over once the application has ended
+    if (supervise_processes()) {
+        BL::logger::debug("Application ended");
+        state.application_launching = false;
+        if (state.application_running) {
+            post_launch();
+            state.application_running = false;
+        }
+    }
+
+    if (gamepad && !state.application_launching && !state.application_running) {
+        BL::StageScope scope(BL::FrameStats::GAMEPAD);
+        if (gamepad->poll())
+            ticks.last_input = ticks.main;
+    }
+    if (ticks.last_input != last_input)
+        layout->wake_screensaver();
+}
+
+// Presses of the same arrow key are collected, so key repeat that outpaces the frame rate
+// turns into one move of several rows instead of being dropped
+void BL::Launcher::queue_move(SDL_Keycode key)
+{
+    if (pending_move.key != key)
+        flush_moves();
+    pending_move.key = key;
+    pending_move.steps++;
+}
+
+void BL::Launcher::flush_moves()
+{
+    if (!pending_move.steps)
+        return;
+    if (pending_move.key == SDLK_DOWN)
+        layout->move_down(pending_move.steps);
+    else
+        layout->move_up(pending_move.steps);
+    pending_move.steps = 0;
+}
+
+void BL::Launcher::wait_for_event()
+{
+    int timeout = layout->get_wait_timeout();
+    auto limit = [&timeout](int t) {
+        if (t >= 0)
+            timeout = timeout < 0 ? t : std::min(timeout, t);
+    };
+    if (gamepad)
+        limit(gamepad->get_wait_timeout());
+    if (state.application_launching)
+        limit(static_cast<int>(APPLICATION_TIMEOUT - std::min<Uint64>(ticks.main - ticks.application_launch, APPLICATION_TIMEOUT)));
+    if (processes_need_polling())
+        limit(APPLICATION_WAIT_PERIOD);
+
+    if (timeout < 0)
+        SDL_WaitEvent(nullptr);
+    else
+        SDL_WaitEventTimeout(nullptr, timeout);
+}
+
+// Nothing runs while an application is in the foreground, no layout updates, timers or screensaver.
+// SDL_WaitEvent sleeps on the display connection until the window gets focus back, and the process
+// supervisor pushes an event when the application exits
+void BL::Launcher::wait_for_application()
+{
+    frame_stats.pause();
+    while (state.application_running && !quit) {
+        if (processes_need_polling())
+            SDL_WaitEventTimeout(nullptr, APPLICATION_WAIT_PERIOD);
+        else
+            SDL_WaitEvent(nullptr);
+        process_events();
+    }
+}
+
+void BL::Launcher::update()
+{
+    BL::StageScope scope(BL::FrameStats::UPDATE);
+    ticks.main = SDL_GetTicks();
+    layout->update();
+}
+
+void BL::Launcher::draw()
+{
+    BL::StageScope scope(BL::FrameStats::DRAW);
+    layout->draw();
+    if (stats_overlay && stats_overlay->is_visible())
+        stats_overlay->draw();
+}
+
+void BL::Launcher::present()
+{
+    BL::StageScope scope(BL::FrameStats::PRESENT);
+    renderer->present();
+}
+
+bool BL::Launcher::is_loading() const
+{
+    return layout->is_loading();
+}
+
+void BL::Launcher::execute_command(const BL::Command &command)
+{
+    const std::string &line = command.get_line();
+
+    // Dry runs only replay navigation, they never start processes or change the power state
+    if (dry_run && std::ranges::find(BL::NAVIGATION_COMMANDS, line) == BL::NAVIGATION_COMMANDS.end()) {
+        BL::logger::debug("Dry run, skipping command '{}'", line);
+        return;
+    }
+
+    // Special commands
+    if (command.is_special()) {
+        if (command.is_fork()) {
+            if (!command.get_process_line().empty())
+                start_process(command, false);
+        }
+        else if (line == ":left")
+            layout->move_left();
+        else if (line == ":right")
+            layout->move_right();
+        else if (line == ":up")
+            layout->move_up();
+        else if (line == ":down")
+            layout->move_down();
+        else if (line == ":select")
+            layout->select();
+        else if (line == ":shutdown")
+            scmd_shutdown();
+        else if (line == ":restart")
+            scmd_restart();
+        else if (line == ":sleep")
+            scmd_sleep();
+        else if (line == ":quit")
+            quit = true;
+        else if (line == ":stats") {
+            if (!stats_overlay)
+                stats_overlay = new BL::StatsOverlay(*renderer, render_w, render_h);
+            stats_overlay->toggle();
+            layout->request_redraw();
+        }
+    }
+
+    // Application launching
+    else {
+        BL::logger::debug("Executing command '{}'", line);
+        state.application_launching = start_process(command, true);
+        if (state.application_launching) {
+            BL::logger::debug("Successfully executed command");
+            ticks.application_launch = ticks.main;
+        }
+        else
+            BL::logger::error("Failed to execute command");
+    }
+}
+
+void BL::Launcher::pre_launch()
+{
+    if (sound)
+        sound->disconnect();
+    if (gamepad)
+        gamepad->disconnect();
+}
+
+void BL::Launcher::post_launch()
+{
+    // The screensaver idle time starts over and the layout is shown as it was left
+    ticks.main = ticks.last_input = SDL_GetTicks();
+    layout->request_redraw();
+    if (sound)
+        sound->connect();
+    if (gamepad)
+        gamepad->connect();
+}
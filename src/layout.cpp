@@ -1,18 +1,25 @@
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <memory>
 #include <array>
+#include <algorithm>
+#include <limits>
 #include <libxml/xmlmemory.h>
 #include <libxml/parser.h>
 #include "logger.hpp"
 #include <SDL3/SDL.h>
 #include <lconfig.h>
+#include "card_cache.hpp"
+#include "asset_cache.hpp"
 #include "config.hpp"
+#include "profiler.hpp"
 #include "layout.hpp"
 #include "image.hpp"
 #include "main.hpp"
 #include "menu.hpp"
 #include "menu_highlight.hpp"
+#include "render_pool.hpp"
 #include "renderer.hpp"
 #include "screensaver.hpp"
 #include "sidebar_entry.hpp"
@@ -24,6 +31,7 @@
 
 extern "C" void libxml2_error_handler(void *ctx, const char *msg, ...);
 extern BL::Config config;
+extern BL::Profiler profiler;
 
 namespace BL {
     void free_xml_char(xmlChar *c)
@@ -54,6 +62,9 @@ namespace BL {
     constexpr float CARD_SPACING = 0.011f;
     constexpr float CARD_WIDTH = CARD_RIGHT_MARGIN - CARD_LEFT_MARGIN;
     constexpr float ERROR_ICON_MARGIN = 0.35f;
+    constexpr Uint8 PLACEHOLDER_ALPHA = 0x40;
+    constexpr int CARD_UPLOADS_PER_FRAME = 4;
+    constexpr int LOADING_POLL_PERIOD = 16; // ms
 }
 
 // Wrapper for libxml2 error messages
@@ -84,31 +95,42 @@ void libxml2_error_handler(void *ctx, const char *msg, ...)
 
 void BL::Layout::render_error_texture()
 {
-    error_texture = renderer->create_texture(card_w + 2*card_shadow_offset, card_h + 2*card_shadow_offset);
-    renderer->composit_texture(*card_shadow_texture, *error_texture, nullptr);
-
-    SDL_FRect bg_rect = {card_shadow_offset, card_shadow_offset, card_w, card_h};
-    BL::Texture *error_bg_texture = renderer->create_texture(*error_bg);
-    BL::free_surface(error_bg);
-    error_bg = nullptr;
-
-    renderer->composit_texture(*error_bg_texture, *error_texture, &bg_rect);
-    delete error_bg_texture;
-
-    BL::Texture *error_icon_texture = renderer->create_texture(*error_icon);
-    BL::free_surface(error_icon);
-    error_icon = nullptr;
-
-    renderer->composit_texture(*error_icon_texture, *error_texture, &error_icon_rect);
-    delete error_icon_texture;
+    if (error_texture)
+        return;
+    error_texture = renderer->create_atlas_texture(*error_surface);
+    BL::free_surface(error_surface);
+    error_surface = nullptr;
 
     // Assign texture to all menus 
     for (BL::Menu &menu : menus)
         menu.set_error_texture(*error_texture);
 }
 
+void BL::Layout::render_placeholder_texture()
+{
+    SDL_Surface *placeholder = SDL_CreateSurface(
+                                   static_cast<int>(std::round(card_w + 2*card_shadow_offset)),
+                                   static_cast<int>(std::round(card_h + 2*card_shadow_offset)),
+                                   SDL_PIXELFORMAT_RGBA32
+                               );
+    SDL_FillSurfaceRect(placeholder, nullptr, SDL_MapSurfaceRGBA(placeholder, 0, 0, 0, 0));
+    SDL_Rect rect = {
+        static_cast<int>(card_shadow_offset),
+        static_cast<int>(card_shadow_offset),
+        static_cast<int>(card_w),
+        static_cast<int>(card_h)
+    };
+    SDL_FillSurfaceRect(placeholder, &rect, SDL_MapSurfaceRGBA(placeholder, 0xFF, 0xFF, 0xFF, BL::PLACEHOLDER_ALPHA));
+    placeholder_texture = renderer->create_atlas_texture(*placeholder);
+    BL::free_surface(placeholder);
+
+    for (BL::Menu &menu : menus)
+        menu.set_placeholder_texture(*placeholder_texture);
+}
+
 void BL::Layout::parse(const std::string &file)
 {
+    BL::ProfileScope scope("parse");
     BL::logger::debug("Parsing layout file '{}'", file);
     xmlNodePtr node;
     
@@ -159,9 +181,10 @@ void BL::Layout::parse(const std::string &file)
     BL::logger::debug("Successfully parsed layout file");
 }
 
-BL::Layout::Press::Press(MenuEntry &entry):
-    entry(&entry),
-    original_rect({entry.get_x(), entry.get_y(), entry.get_w(), entry.get_h()}),
+BL::Layout::Press::Press(Menu &menu, size_t index):
+    menu(&menu),
+    index(index),
+    original_rect(menu.get_card_rect(index)),
     total(std::round(original_rect.w * BL::ENTRY_SHRINK_DISTANCE)),
     current(0.f),
     velocity(2.f * total / static_cast<float>(BL::ENTRY_PRESS_TIME)),
@@ -172,15 +195,17 @@ BL::Layout::Press::Press(MenuEntry &entry):
 
 void BL::Layout::load_background()
 {
+    BL::ProfileScope scope("load_background");
     if (!config.background_image_path.empty()) {
         background_surface = (config.background_image_path.ends_with(".svg")) 
                              ? rasterizer->rasterize_svg_from_file(config.background_image_path, screen_width, screen_height) 
-                             : BL::load_surface(config.background_image_path);
+                             : BL::load_surface(config.background_image_path, screen_width, screen_height);
     }
 }
 
 void BL::Layout::load_sidebar()
 {
+    BL::ProfileScope scope("load_sidebar");
     // Sidebar highlight geometry calculations and rendering
     float sidebar_width = std::round(f_screen_width * BL::SIDEBAR_HIGHLIGHT_WIDTH);
     float sidebar_height = std::round(f_screen_height * BL::SIDEBAR_HIGHLIGHT_HEIGHT);
@@ -189,6 +214,7 @@ void BL::Layout::load_sidebar()
     sidebar_y_advance = std::round(f_screen_height * BL::SIDEBAR_Y_ADVANCE);
 
     sidebar_highlight = new BL::SidebarHighlight();
+    object_groups[Shift::Type::SIDEBAR] = {sidebar_highlight};
     sidebar_highlight->render_surface(*rasterizer, sidebar_width, sidebar_height, sidebar_cx);
     sidebar_highlight->set_x(std::round(f_screen_width * BL::SIDEBAR_HIGHLIGHT_LEFT));
     sidebar_highlight->set_y(y_min);
@@ -226,6 +252,7 @@ void BL::Layout::load_sidebar()
 
 void BL::Layout::load_menus()
 {
+    BL::ProfileScope scope("load_menus");
     // Menu card geometry calculations
     card_x0 = std::round(f_screen_width * BL::CARD_LEFT_MARGIN);
     card_y0 = y_min;
@@ -246,37 +273,48 @@ void BL::Layout::load_menus()
     };
     card_shadow_offset = std::round(max_blur * 2.f);
 
-    SDL_Surface *shadow_box = SDL_CreateSurface(card_w, card_h, SDL_PIXELFORMAT_RGBA32);
-    Uint32 white = SDL_MapSurfaceRGBA(shadow_box, 0xFF, 0xFF, 0xFF, 0xFF);
-    SDL_FillSurfaceRect(shadow_box, nullptr, white);
-    card_shadow = BL::create_shadow(shadow_box, box_shadows, card_shadow_offset);
-    BL::free_surface(shadow_box);
-
-    // Load cards
+    // Load cards from the cache
     float card_x_advance = card_w + card_spacing;
     card_y_advance = card_h + card_spacing;
     max_rows = static_cast<int>(std::floor((y_max - y_min) / card_y_advance)); // max number of rows that can fit on the screen at once
     y_leftover = y_max - (y_min + static_cast<float>(max_rows) * card_h + static_cast<float>(max_rows - 1) * card_spacing);
-    for (BL::Menu &menu : menus)
-        card_error |= !menu.render_surfaces(*rasterizer, card_w, card_h, card_shadow_offset);
-    if (card_error)
-        render_error_surface();
+    if (config.card_cache)
+        card_cache = new BL::CardCache(box_shadows, card_shadow_offset, card_w, card_h);
+    std::unordered_map<Uint64, BL::MenuEntry*> cards;
+    int misses = 0;
+    int num_entries = 0;
+    for (BL::Menu &menu : menus) {
+        misses += menu.load_cached_surfaces(card_cache, card_w, card_h, card_shadow_offset, cards);
+        num_entries += static_cast<int>(menu.num_entries());
+    }
+    BL::logger::debug("{} unique cards for {} entries", cards.size(), num_entries);
+
+    // Render the cards that weren't cached
+    if (misses) {
+        BL::RoundedRect shadow_box = {static_cast<int>(card_w), static_cast<int>(card_h), 0.f};
+        card_shadow = BL::create_shadow(shadow_box, box_shadows, card_shadow_offset);
+        start_rendering(misses);
+    }
+    else
+        finish_rendering();
 
     // Set positions
     float y = card_y0;
-    menu_objects.reserve(menus.size());
+    menu_column = new BL::MenuColumn();
     for (BL::SidebarEntry &entry : sidebar_entries) {
         if (BL::Menu *menu = entry.get_menu(); menu) {
+            menu->set_column(*menu_column);
             menu->set_x_advance(card_x_advance);
             menu->set_y_advance(card_y_advance);
             menu->set_x(card_x0);
             menu->set_y(y);
             y += std::max(menu->get_h() + y_leftover, f_screen_height);
-            menu_objects.push_back(menu);
         }
         else
             y += f_screen_height;
     }
+    if (!menus.empty())
+        object_groups[Shift::Type::MENU] = {menu_column};
 
     menu_clip = {
         0,
@@ -289,6 +327,7 @@ void BL::Layout::load_menus()
 
 void BL::Layout::load_menu_highlight()
 {
+    BL::ProfileScope scope("load_menu_highlight");
     int t = static_cast<int>(std::round(card_spacing * HIGHLIGHT_THICKNESS));
     float inner_spacing = static_cast<int>(std::round(card_spacing * HIGHLIGHT_INNER_SPACING));
     highlight_x0 = card_x0 - (inner_spacing + t);
@@ -298,6 +337,7 @@ void BL::Layout::load_menu_highlight()
     int highlight_h = static_cast<int>(card_h) + padding; 
 
     menu_highlight = new BL::MenuHighlight();
+    object_groups[Shift::Type::HIGHLIGHT] = {menu_highlight};
     menu_highlight->render_surface(*rasterizer,
         highlight_w, 
         highlight_h, 
@@ -327,32 +367,144 @@ void BL::Layout::load_surfaces()
         screensaver->render_surface();
     }
 
+    // Only the current menu is needed for the first frame
+    if (current_menu)
+        wait_for_menu(*current_menu);
     BL::logger::debug("Successfully rendered surfaces");
 }
 
-void BL::Layout::render_error_surface()
+// Fans the uncached cards out over all cores. The cards of the current menu are queued first,
+// the other menus are rendered in the background and picked up by update() as they complete
+void BL::Layout::start_rendering(int misses)
+{
+    std::vector<size_t> order(menus.size());
+    for (size_t i = 0; i < menus.size(); i++)
+        order[i] = i;
+    if (current_menu)
+        std::rotate(order.begin(), order.begin() + (current_menu - &menus[0]), order.begin() + (current_menu - &menus[0]) + 1);
+
+    // Unique cards in submission order, with the menus waiting on each of them
+    std::vector<BL::MenuEntry*> cards;
+    std::unordered_map<BL::MenuEntry*, std::vector<size_t>> waiting;
+    pending_cards = std::vector<std::atomic<int>>(menus.size());
+    for (size_t i : order) {
+        for (BL::MenuEntry *card : menus[i].get_unrendered_cards()) {
+            std::vector<size_t> &card_menus = waiting[card];
+            if (card_menus.empty())
+                cards.push_back(card);
+            card_menus.push_back(i);
+            pending_cards[i]++;
+        }
+        if (pending_cards[i]) {
+            menus[i].set_ready(false);
+            menus_pending++;
+        }
+    }
+
+    assets = new BL::AssetCache();
+    render_pool = new BL::RenderPool(std::min(misses, SDL_GetNumLogicalCPUCores()));
+    for (BL::MenuEntry *card : cards) {
+        const std::string &menu_title = menus[waiting[card].front()].get_title();
+        render_pool->submit([this, card, &menu_title, card_menus = std::move(waiting[card])](BL::SVGRasterizer &rasterizer) {
+            {
+                BL::EntryProfileScope scope(card->get_title(), menu_title, "render_surface");
+                if (!card->render_surface(rasterizer, *card_shadow, card_cache, *assets))
+                    card->set_card_error(true);
+            }
+            for (size_t i : card_menus) {
+                pending_cards[i].fetch_sub(1, std::memory_order_release);
+                pending_cards[i].notify_all();
+            }
+        });
+    }
+}
+
+void BL::Layout::wait_for_menu(BL::Menu &menu)
+{
+    size_t i = &menu - &menus[0];
+    if (menu.is_ready())
+        return;
+    for (int pending; (pending = pending_cards[i].load(std::memory_order_acquire));)
+        pending_cards[i].wait(pending, std::memory_order_acquire);
+    set_menu_ready(i);
+}
+
+void BL::Layout::set_menu_ready(size_t i)
+{
+    BL::Menu &menu = menus[i];
+    menu.set_ready(true);
+    BL::logger::debug("Rendered cards of menu '{}' after {} ms", menu.get_title(), SDL_GetTicks());
+    if (menu.has_card_error()) {
+        card_error = true;
+        render_error_surface(*card_shadow);
+        if (renderer)
+            render_error_texture();
+    }
+    textures_pending = true;
+    if (!--menus_pending)
+        finish_rendering();
+}
+
+// Picks up menus whose cards were completed by the render pool
+void BL::Layout::poll_menus()
+{
+    for (size_t i = 0; i < menus.size() && menus_pending; i++) {
+        if (!menus[i].is_ready() && !pending_cards[i].load(std::memory_order_acquire))
+            set_menu_ready(i);
+    }
+}
+
+void BL::Layout::finish_rendering()
+{
+    delete render_pool;
+    render_pool = nullptr;
+    if (assets)
+        BL::logger::debug("Card assets: {} shared, {} loaded", assets->get_hits(), assets->get_misses());
+    delete assets;
+    assets = nullptr;
+    BL::free_surface(card_shadow);
+    card_shadow = nullptr;
+    if (card_cache)
+        BL::logger::debug("Card cache: {} hits, {} misses", card_cache->get_hits(), card_cache->get_misses());
+    delete card_cache;
+    card_cache = nullptr;
+}
+
+void BL::Layout::render_error_surface(const SDL_Surface &shadow)
 {
-    if (error_bg || error_icon)
+    if (error_surface || error_texture)
         return;
     
-    error_bg = SDL_CreateSurface(static_cast<int>(card_w), static_cast<int>(card_h), SDL_PIXELFORMAT_RGBA32);
-    Uint32 color = SDL_MapSurfaceRGBA(error_bg, 0xFF, 0xFF, 0xFF, 0xFF);
-    SDL_FillSurfaceRect(error_bg, nullptr, color);
+    // Background
+    error_surface = BL::copy_surface(shadow);
+    SDL_Rect bg_rect = {
+        static_cast<int>(card_shadow_offset),
+        static_cast<int>(card_shadow_offset),
+        static_cast<int>(card_w),
+        static_cast<int>(card_h)
+    };
+    Uint32 color = SDL_MapSurfaceRGBA(error_surface, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_FillSurfaceRect(error_surface, &bg_rect, color);
 
-    // Geometry
+    // Icon
     float target_h = std::round(card_h  * (1.0f - 2.0f * BL::ERROR_ICON_MARGIN));
     float target_w = target_h;
-    error_icon_rect = {
-        std::round((card_w - target_w) / 2.f + card_shadow_offset),
-        std::round(BL::ERROR_ICON_MARGIN * card_h + card_shadow_offset),
-        std::round(target_w),
-        std::round(target_h)
+    SDL_Rect error_icon_rect = {
+        static_cast<int>(std::round((card_w - target_w) / 2.f + card_shadow_offset)),
+        static_cast<int>(std::round(BL::ERROR_ICON_MARGIN * card_h + card_shadow_offset)),
+        static_cast<int>(std::round(target_w)),
+        static_cast<int>(std::round(target_h))
     };
-    error_icon = rasterizer->rasterize_svg(std::string(ERROR_FORMAT), target_w, target_h);
+    SDL_Surface *error_icon = rasterizer->rasterize_svg(std::string(ERROR_FORMAT), target_w, target_h);
+    if (error_icon) {
+        SDL_BlitSurface(error_icon, nullptr, error_surface, &error_icon_rect);
+        BL::free_surface(error_icon);
+    }
 }
 
 void BL::Layout::load_textures(BL::Renderer &renderer)
 {
+    BL::ProfileScope scope("load_textures");
     this->renderer = &renderer;
     BL::logger::debug("Rendering textures...");
 
@@ -365,24 +517,23 @@ void BL::Layout::load_textures(BL::Renderer &renderer)
     sidebar_highlight->render_texture();
 
     // Render sidebar texts
-    card_shadow_texture = renderer.create_texture(*card_shadow);
-    BL::free_surface(card_shadow);
-    card_shadow = nullptr;
     for (BL::SidebarEntry &entry : sidebar_entries) {
         entry.set_renderer(renderer);
         entry.render_texture();
         entry.set_text_color(&entry == &*current_entry ? config.sidebar_text_color_highlighted : config.sidebar_text_color);
     }
+    static_layer = renderer.create_layer(screen_width, screen_height);
 
-    // Render application cards
+    // Render application cards. Only the current menu is uploaded up front, the rest is streamed in by update()
     for (BL::Menu &menu : menus) {
         menu.set_renderer(renderer);
-        menu.render_card_textures(*card_shadow_texture, card_shadow_offset, card_w, card_h);
     }
-    if (card_error)
+    if (error_surface)
         render_error_texture();
-    delete card_shadow_texture;
-    card_shadow_texture = nullptr;
+    render_placeholder_texture();
+    update_residency(Direction::DOWN);
+    if (current_menu)
+        current_menu->load_textures(std::numeric_limits<int>::max());
 
     // Render menu highlight
     menu_highlight->set_renderer(renderer);
@@ -396,126 +547,154 @@ void BL::Layout::load_textures(BL::Renderer &renderer)
     BL::logger::debug("Sucessfully rendered textures");
 }
 
-void BL::Layout::move_up()
+// Moves are taken several steps at a time when key presses were queued up, every moving
+// object group then gets one shift to where the last step would have left it
+void BL::Layout::move_up(int steps)
 {
+    redraw = true;
     if (selection_mode == SelectionMode::SIDEBAR) {
-        if (!sidebar_pos)
-            return;
-        if (sidebar_shift_count && sidebar_pos == sidebar_shift_count){
-            add_shift(Shift::Type::SIDEBAR, Direction::DOWN, sidebar_y_advance, BL::SIDEBAR_SHIFT_TIME, {sidebar_highlight});
-            sidebar_shift_count--;
-        }
+        std::vector<SidebarEntry>::iterator previous_entry = current_entry;
+        for (; steps && sidebar_pos; steps--) {
+            if (sidebar_shift_count && sidebar_pos == sidebar_shift_count){
+                add_shift(Shift::Type::SIDEBAR, Direction::DOWN, sidebar_y_advance, BL::SIDEBAR_SHIFT_TIME);
+                sidebar_shift_count--;
+            }
 
-        // Shift menus if necessary
-        if (!menu_objects.empty()) {
-            float shift_amount;
-            BL::Menu *next_menu = (current_entry - 1)->get_menu();
-            shift_amount = next_menu ? card_y0 - next_menu->get_y() : f_screen_height;
-            add_shift(
-                Shift::Type::MENU,
-                Direction::DOWN,
-                shift_amount,
-                BL::SIDEBAR_SHIFT_TIME,
-                menu_objects,
-                next_menu ? Shift::Method::ABS : Shift::Method::REL
-            );
+            // Shift menus if necessary
+            if (!object_groups[Shift::Type::MENU].empty()) {
+                float shift_amount;
+                BL::Menu *next_menu = (current_entry - 1)->get_menu();
+                shift_amount = next_menu ? card_y0 - next_menu->get_y() : f_screen_height;
+                add_shift(
+                    Shift::Type::MENU,
+                    Direction::DOWN,
+                    shift_amount,
+                    BL::SIDEBAR_SHIFT_TIME,
+                    next_menu ? Shift::Method::ABS : Shift::Method::REL
+                );
+            }
+            current_entry--;
+            sidebar_pos--;
         }
+        if (current_entry == previous_entry)
+            return;
 
         // Adjust texture color
-        current_entry->set_text_color(config.sidebar_text_color);
-        current_entry--;
+        previous_entry->set_text_color(config.sidebar_text_color);
         current_menu = current_entry->get_menu();
         current_entry->set_text_color(config.sidebar_text_color_highlighted);
-        sidebar_highlight->dec_y(sidebar_y_advance);
-        sidebar_pos--;
+        static_layer_dirty = true;
+        sidebar_highlight->dec_y(sidebar_y_advance * static_cast<float>(previous_entry - current_entry));
+        update_residency(Direction::UP);
         launcher.play_click();
     }
 
     else if (selection_mode == SelectionMode::MENU && current_menu->get_row()) {
-        if (current_menu->get_row() > 2) {
-            current_menu->dec_shift_count();
-            add_shift(Shift::Type::MENU, Direction::DOWN, (card_y0 - current_menu->get_shift_count() * card_y_advance) - current_menu->get_y(), BL::ROW_SHIFT_TIME, menu_objects, Shift::Method::ABS);
+        int highlight_rows = 0;
+        bool scrolled = false;
+        for (; steps && current_menu->get_row(); steps--) {
+            if (current_menu->get_row() > 2) {
+                current_menu->dec_shift_count();
+                scrolled = true;
+            }
+            else
+                highlight_rows++;
+            current_menu->dec_row();
         }
-        else
-            add_shift(Shift::Type::HIGHLIGHT, Direction::UP, highlight_y_advance, BL::HIGHLIGHT_SHIFT_TIME, {menu_highlight});
-
-        current_menu->dec_row();
+        if (scrolled)
+            add_shift(Shift::Type::MENU, Direction::DOWN, (card_y0 - current_menu->get_shift_count() * card_y_advance) - current_menu->get_y(), BL::ROW_SHIFT_TIME, Shift::Method::ABS);
+        if (highlight_rows)
+            add_shift(Shift::Type::HIGHLIGHT, Direction::UP, highlight_y_advance * highlight_rows, BL::HIGHLIGHT_SHIFT_TIME);
         launcher.play_click();
     }
 }
 
-void BL::Layout::move_down()
+void BL::Layout::move_down(int steps)
 {
+    redraw = true;
     if (selection_mode == SelectionMode::SIDEBAR) {
-        if ((sidebar_pos < (num_sidebar_entries - 1))) {
-
-            // Shift menus if necessary
-            if (!menu_objects.empty()) {
-                float shift_amount;
-                BL::Menu *next_menu = (current_entry + 1)->get_menu();
-                shift_amount = next_menu ? next_menu->get_y() - card_y0 : f_screen_height;
-                add_shift(
-                    Shift::Type::MENU,
-                    Direction::UP,
-                    shift_amount,
-                    BL::SIDEBAR_SHIFT_TIME,
-                    menu_objects,
-                    next_menu ? Shift::Method::ABS : Shift::Method::REL
-                );
+        std::vector<SidebarEntry>::iterator previous_entry = current_entry;
+        for (; steps; steps--) {
+            if ((sidebar_pos < (num_sidebar_entries - 1))) {
+
+                // Shift menus if necessary
+                if (!object_groups[Shift::Type::MENU].empty()) {
+                    float shift_amount;
+                    BL::Menu *next_menu = (current_entry + 1)->get_menu();
+                    shift_amount = next_menu ? next_menu->get_y() - card_y0 : f_screen_height;
+                    add_shift(
+                        Shift::Type::MENU,
+                        Direction::UP,
+                        shift_amount,
+                        BL::SIDEBAR_SHIFT_TIME,
+                        next_menu ? Shift::Method::ABS : Shift::Method::REL
+                    );
+                }
+                current_entry++;
+                sidebar_pos++;
             }
 
-            // Adjust text color
-            current_entry->set_text_color(config.sidebar_text_color);
-            current_entry++;
-            current_menu = current_entry->get_menu();
-            current_entry->set_text_color(config.sidebar_text_color_highlighted);
-            sidebar_highlight->inc_y(sidebar_y_advance);
-            sidebar_pos++;
-            launcher.play_click();
+            // Shift sidebar highlight
+            if (max_sidebar_entries != -1 && sidebar_pos < (num_sidebar_entries - max_sidebar_entries)) {
+                add_shift(Shift::Type::SIDEBAR, Direction::UP, sidebar_y_advance, BL::SIDEBAR_SHIFT_TIME);
+                sidebar_shift_count++;
+            }
         }
+        if (current_entry == previous_entry)
+            return;
 
-        // Shift sidebar highlight
-        if (max_sidebar_entries != -1 && sidebar_pos < (num_sidebar_entries - max_sidebar_entries)) {
-            add_shift(Shift::Type::SIDEBAR, Direction::UP, sidebar_y_advance, BL::SIDEBAR_SHIFT_TIME, {sidebar_highlight});
-            sidebar_shift_count++;
-        }
+        // Adjust text color
+        previous_entry->set_text_color(config.sidebar_text_color);
+        current_menu = current_entry->get_menu();
+        current_entry->set_text_color(config.sidebar_text_color_highlighted);
+        static_layer_dirty = true;
+        sidebar_highlight->inc_y(sidebar_y_advance * static_cast<float>(current_entry - previous_entry));
+        update_residency(Direction::DOWN);
+        launcher.play_click();
     }
 
     // We are in menu mode
     else if (selection_mode == SelectionMode::MENU) {
-        if (current_menu->get_row() * BL::COLUMNS + current_menu->get_column() + BL::COLUMNS < current_menu->num_entries()) {
-
+        int highlight_rows = 0;
+        bool scrolled = false;
+        for (; steps && current_menu->get_row() * BL::COLUMNS + current_menu->get_column() + BL::COLUMNS < current_menu->num_entries(); steps--) {
             if ((current_menu->get_row() < (current_menu->get_total_rows() - 1) && current_menu->get_row() >= (max_rows - 1))) {
                 current_menu->inc_shift_count();
-                add_shift(Shift::Type::MENU, Direction::UP, current_menu->get_y() - (card_y0 - current_menu->get_shift_count() * card_y_advance), BL::ROW_SHIFT_TIME, menu_objects, Shift::Method::ABS);
+                scrolled = true;
             }
             else
-                add_shift(Shift::Type::HIGHLIGHT, Direction::DOWN, highlight_y_advance, BL::HIGHLIGHT_SHIFT_TIME, {menu_highlight});
-
+                highlight_rows++;
             current_menu->inc_row();
-            launcher.play_click();
         }
+        if (scrolled)
+            add_shift(Shift::Type::MENU, Direction::UP, current_menu->get_y() - (card_y0 - current_menu->get_shift_count() * card_y_advance), BL::ROW_SHIFT_TIME, Shift::Method::ABS);
+        if (highlight_rows)
+            add_shift(Shift::Type::HIGHLIGHT, Direction::DOWN, highlight_y_advance * highlight_rows, BL::HIGHLIGHT_SHIFT_TIME);
+        if (scrolled || highlight_rows)
+            launcher.play_click();
     }
 }
 
 
 void BL::Layout::move_left()
 {
+    redraw = true;
     if (selection_mode == SelectionMode::MENU) {
         if (current_menu->get_column() == 0) {
-            if (shift_queue.empty()) {
+            if (shifts.empty()) {
                 selection_mode = SelectionMode::SIDEBAR;
                 current_entry->set_text_color(config.sidebar_text_color_highlighted);
+                static_layer_dirty = true;
                 current_menu->reset_row();
                 current_menu->reset_shift_count();
                 menu_highlight->set_y(highlight_y0);
                 launcher.play_click();
-                add_shift(Shift::Type::MENU, Direction::DOWN, card_y0 - current_menu->get_y(), BL::HIGHLIGHT_SHIFT_TIME, menu_objects);
+                add_shift(Shift::Type::MENU, Direction::DOWN, card_y0 - current_menu->get_y(), BL::HIGHLIGHT_SHIFT_TIME);
             }
         }
         else {
             // Move highlight left
-            add_shift(Shift::Type::HIGHLIGHT, Direction::LEFT, highlight_x_advance, BL::HIGHLIGHT_SHIFT_TIME, {menu_highlight});
+            add_shift(Shift::Type::HIGHLIGHT, Direction::LEFT, highlight_x_advance, BL::HIGHLIGHT_SHIFT_TIME);
             current_menu->dec_column();
             launcher.play_click();
         }
@@ -525,10 +704,12 @@ void BL::Layout::move_left()
 
 void BL::Layout::move_right()
 {
-    if (selection_mode == SelectionMode::SIDEBAR && current_menu && shift_queue.empty()) {
+    redraw = true;
+    if (selection_mode == SelectionMode::SIDEBAR && current_menu && shifts.empty()) {
         selection_mode = SelectionMode::MENU;
         current_menu->reset_row();
         current_entry->set_text_color(config.sidebar_text_color);
+        static_layer_dirty = true;
         launcher.play_click();
     }
 
@@ -539,7 +720,7 @@ void BL::Layout::move_right()
         if(current_menu->get_column() < max_columns - 1) {
             
             // Shift highlight right
-            add_shift(Shift::Type::HIGHLIGHT, Direction::RIGHT, highlight_x_advance, HIGHLIGHT_SHIFT_TIME, {menu_highlight});
+            add_shift(Shift::Type::HIGHLIGHT, Direction::RIGHT, highlight_x_advance, HIGHLIGHT_SHIFT_TIME);
             current_menu->inc_column();
             launcher.play_click();
         }
@@ -548,8 +729,9 @@ void BL::Layout::move_right()
 
 void BL::Layout::select()
 {
+    redraw = true;
     if (selection_mode == SelectionMode::SIDEBAR) {
-        if (const std::string *command = current_entry->get_command(); command) {
+        if (const BL::Command *command = current_entry->get_command(); command) {
             launcher.execute_command(*command);
             launcher.play_select();
         }
@@ -557,12 +739,67 @@ void BL::Layout::select()
     else if (selection_mode == SelectionMode::MENU) {
         MenuEntry &entry = current_menu->get_current_entry();
         BL::logger::debug("User selected entry '{}'", entry.get_title());
-        add_press(entry);
+        add_press(*current_menu, current_menu->get_current_index());
         launcher.play_select();
     }
 }
 
-void BL::Layout::add_shift(Shift::Type type, Direction direction, float target, float time, const std::vector<BL::Object*> &objects, Shift::Method method)
+// Card textures are only kept for the current menu, its neighbours and the menu after next in the direction
+// of movement. Other menus stay resident until the texture budget is exceeded, then they are evicted LRU first
+void BL::Layout::update_residency(Direction direction)
+{
+    Uint64 ticks = SDL_GetTicks();
+    int ahead = direction == Direction::UP ? -1 : 1;
+    resident_menus.clear();
+    for (int pos : {sidebar_pos, sidebar_pos + ahead, sidebar_pos - ahead, sidebar_pos + 2*ahead}) {
+        if (pos < 0 || pos >= num_sidebar_entries)
+            continue;
+        BL::Menu *menu = sidebar_entries[pos].get_menu();
+        if (menu && std::find(resident_menus.begin(), resident_menus.end(), menu) == resident_menus.end()) {
+            menu->set_last_used(ticks);
+            resident_menus.push_back(menu);
+        }
+    }
+    evict_textures();
+    textures_pending = true;
+}
+
+void BL::Layout::evict_textures()
+{
+    size_t resident_bytes = 0;
+    size_t needed_bytes = 0;
+    for (const BL::Menu &menu : menus)
+        resident_bytes += menu.get_texture_bytes();
+    for (const BL::Menu *menu : resident_menus)
+        needed_bytes += menu->get_missing_texture_bytes();
+
+    while (resident_bytes + needed_bytes > texture_budget) {
+        BL::Menu *lru = nullptr;
+        for (BL::Menu &menu : menus) {
+            if (menu.get_texture_bytes() && 
+            std::find(resident_menus.begin(), resident_menus.end(), &menu) == resident_menus.end() &&
+            (!lru || menu.get_last_used() < lru->get_last_used()))
+                lru = &menu;
+        }
+        if (!lru)
+            break;
+        BL::logger::debug("Evicting card textures of menu '{}'", lru->get_title());
+        resident_bytes -= lru->get_texture_bytes();
+        lru->unload_textures();
+    }
+}
+
+void BL::Layout::upload_textures(int max_uploads)
+{
+    for (BL::Menu *menu : resident_menus) {
+        max_uploads -= menu->load_textures(max_uploads);
+        if (!max_uploads)
+            return;
+    }
+    textures_pending = false;
+}
+
+void BL::Layout::add_shift(Shift::Type type, Direction direction, float target, float time, Shift::Method method)
 {
     static const std::array<Direction, 4> opposites {{
         Direction::DOWN,
@@ -573,139 +810,249 @@ void BL::Layout::add_shift(Shift::Type type, Direction direction, float target,
     Direction opposite = opposites[static_cast<int>(direction)];
 
     // Interrupt if opposite direction shift is in progress
-    for (Shift &shift : shift_queue) {
-        if (shift.type == type) {
-            if (shift.direction == opposite) {
-                if (method == BL::Layout::Shift::Method::REL)
-                    shift.target = target - (shift.target - shift.total);
-                else {
-                    shift.target = target;
-                    shift.velocity = shift.target / time;
-                }
-                shift.total = 0.f;
-                shift.direction = direction;
-                shift.ticks = SDL_GetTicks();
-                shift.method = method;
-                return;
-            }
-            else if (shift.direction == direction) {
-                shift.target = method == BL::Layout::Shift::Method::ABS ? target : (shift.target - shift.total) + target;
-                shift.method = method;
-                shift.ticks = SDL_GetTicks();
-                shift.total = 0.f;
-                shift.velocity = (shift.velocity + shift.target / time) / 2.f;
-                return;
+    Shift *merged = nullptr;
+    shifts.for_each([&](Shift &shift) {
+        if (merged || shift.type != type)
+            return;
+        if (shift.direction == opposite) {
+            if (method == BL::Layout::Shift::Method::REL)
+                shift.target = target - (shift.target - shift.total);
+            else {
+                shift.target = target;
+                shift.velocity = shift.target / time;
             }
+            shift.total = 0.f;
+            shift.direction = direction;
+            shift.ticks = SDL_GetTicks();
+            shift.method = method;
+            merged = &shift;
         }
-    }
+        else if (shift.direction == direction) {
+            shift.target = method == BL::Layout::Shift::Method::ABS ? target : (shift.target - shift.total) + target;
+            shift.method = method;
+            shift.ticks = SDL_GetTicks();
+            shift.total = 0.f;
+            shift.velocity = shift.target / time;
+            merged = &shift;
+        }
+    });
+    if (merged)
+        return;
 
-    // Add new shift to queue
-    shift_queue.emplace_back(
-            type,
-            method,
-            direction,
-            target / time,
-            target,
-            objects
-    );
+    // Start a new shift, the oldest one jumps to its end if every slot is taken
+    if (shifts.full())
+        finish_shift(*shifts.oldest());
+    *shifts.acquire() = Shift(type, method, direction, target / time, target);
 }
 
+void BL::Layout::apply_shift(Shift &shift, float change)
+{
+    if (shift.direction == Direction::UP || shift.direction == Direction::LEFT)
+        change *= -1.f;
+    if (shift.direction == Direction::UP || shift.direction == Direction::DOWN) {
+        for (BL::Object *object : object_groups[shift.type])
+            object->inc_y(change);
+    }
+    else {
+        for (BL::Object *object : object_groups[shift.type])
+            object->inc_x(change);
+    }
+}
+
+void BL::Layout::finish_shift(Shift &shift)
+{
+    apply_shift(shift, shift.target - shift.total);
+    shifts.release(shift);
+}
 
 void BL::Layout::update_shift()
 {
     Uint64 ticks = SDL_GetTicks();
-    for (auto shift = shift_queue.begin(); shift != shift_queue.end();) {
-        
+    shifts.for_each([&](Shift &shift) {
+
         // Calculate position change based on velocity and time elapsed
-        float current =  (static_cast<float>(ticks - shift->ticks)) * shift->velocity;
-        if (shift->total + current > shift->target)
-            current = shift->target - shift->total;
-        shift->total += current;
-        if (shift->direction == Direction::UP || shift->direction == Direction::LEFT)
-            current *= -1.f;
-
-        if (shift->direction == Direction::UP || shift->direction == Direction::DOWN) {
-            for (BL::Object *object : shift->objects)
-                object->inc_y(current);
-        }
-        else {
-            for (BL::Object *object : shift->objects)
-                object->inc_x(current);         
-        }
-        shift->ticks = ticks;
-        shift = shift->target == shift->total ? shift_queue.erase(shift) : shift + 1;
-    }
+        float current = (static_cast<float>(ticks - shift.ticks)) * shift.velocity;
+        if (shift.total + current > shift.target)
+            current = shift.target - shift.total;
+        shift.total += current;
+        apply_shift(shift, current);
+        shift.ticks = ticks;
+        if (shift.target == shift.total)
+            shifts.release(shift);
+    });
+}
+
+void BL::Layout::add_press(Menu &menu, size_t index)
+{
+    if (presses.full())
+        finish_press(*presses.oldest());
+    *presses.acquire() = Press(menu, index);
+    menu.begin_press();
+}
+
+// Restores the card and runs its command
+void BL::Layout::finish_press(Press &press)
+{
+    press.menu->set_card_rect(press.index, press.original_rect);
+    press.menu->end_press();
+    launcher.execute_command(press.menu->get_entry(press.index).get_command());
+    presses.release(press);
 }
 
 void BL::Layout::update_press()
 {
-    for (auto press = press_queue.begin(); press != press_queue.end();) {
+    presses.for_each([&](Press &press) {
         Uint64 current_ticks = SDL_GetTicks();
-        float change = (static_cast<float>(current_ticks - press->ticks) * press->velocity);
-        if (press->direction == Direction::RIGHT) {
-            press->current += change;
-            if (press->current >= press->total) {
-                press->current = press->total;
-                press->direction = Direction::LEFT;
+        float change = (static_cast<float>(current_ticks - press.ticks) * press.velocity);
+        if (press.direction == Direction::RIGHT) {
+            press.current += change;
+            if (press.current >= press.total) {
+                press.current = press.total;
+                press.direction = Direction::LEFT;
             }
         }
-        else if (press->direction == Direction::LEFT) {
-            press->current -= change;
-            if (press->current <= 0.f) {
-                press->entry->set_x(press->original_rect.x);
-                press->entry->set_y(press->original_rect.y);
-                press->entry->set_w(press->original_rect.w);
-                press->entry->set_h(press->original_rect.h);
-                launcher.execute_command(press->entry->get_command());
-                press = press_queue.erase(press);
-                continue;
+        else if (press.direction == Direction::LEFT) {
+            press.current -= change;
+            if (press.current <= 0.f) {
+                finish_press(press);
+                return;
             }
         }
-        float w = press->original_rect.w - 2.f * press->current;
-        float h = w / press->aspect_ratio;
-        press->entry->set_x(press->original_rect.x + press->current);
-        press->entry->set_y(press->original_rect.y + (press->current / press->aspect_ratio));
-        press->entry->set_w(w);
-        press->entry->set_h(h);
-        press->ticks = current_ticks;
-        ++press;
-    }
+        float w = press.original_rect.w - 2.f * press.current;
+        float h = w / press.aspect_ratio;
+        press.menu->set_card_rect(press.index, {
+            press.original_rect.x + press.current,
+            press.original_rect.y + (press.current / press.aspect_ratio),
+            w,
+            h
+        });
+        press.ticks = current_ticks;
+    });
 }
 
+// Anything that changes what is on screen marks the layout for redraw
 void BL::Layout::update()
 {
-    if (!shift_queue.empty())
+    if (menus_pending)
+        poll_menus();
+    if (textures_pending) {
+        upload_textures(BL::CARD_UPLOADS_PER_FRAME);
+        redraw = true;
+    }
+    if (!shifts.empty()) {
         update_shift();
-    if (!press_queue.empty())
+        redraw = true;
+    }
+    if (!presses.empty()) {
         update_press();
-    if (screensaver)
-        screensaver->update();
+        redraw = true;
+    }
+    if (screensaver && screensaver->update())
+        redraw = true;
 }
 
-void BL::Layout::draw()
+// Milliseconds until the layout changes without any input, -1 if it never does
+int BL::Layout::get_wait_timeout() const
 {
-    renderer->clear();
+    int timeout = menus_pending ? BL::LOADING_POLL_PERIOD : -1;
+    if (screensaver && !screensaver->is_active()) {
+        int idle_timeout = screensaver->get_idle_timeout();
+        timeout = timeout < 0 ? idle_timeout : std::min(timeout, idle_timeout);
+    }
+    return timeout;
+}
+
+// Input dismisses the screensaver right away, even if it changes nothing else on screen
+void BL::Layout::wake_screensaver()
+{
+    if (screensaver && screensaver->is_active()) {
+        screensaver->deactivate();
+        redraw = true;
+    }
+}
 
-    // Draw background
+// Render target contents are lost on a render target reset, every layer is composed again
+void BL::Layout::invalidate_layers()
+{
+    static_layer_dirty = true;
+    for (BL::Menu &menu : menus)
+        menu.invalidate_grid_layer();
+    redraw = true;
+}
+
+// Draws the background and the sidebar texts outside of [skip_begin, skip_end)
+void BL::Layout::draw_static(size_t skip_begin, size_t skip_end)
+{
     if (background_texture)
         renderer->draw(*background_texture);
+    renderer->set_clip_rect(sidebar_text_clip);
+    for (size_t i = 0; i < sidebar_entries.size(); i++) {
+        if (i < skip_begin || i >= skip_end)
+            sidebar_entries[i].draw();
+    }
+    renderer->disable_clip();
+}
 
-    // Draw sidebar highlight
-    if (selection_mode == SelectionMode::SIDEBAR) {
-        renderer->set_clip_rect(sidebar_highlight_clip);
-        sidebar_highlight->draw();
+void BL::Layout::draw()
+{
+    renderer->clear();
+
+    // Draw background and sidebar texts
+    if (static_layer) {
+        // The texts touching the highlight or its shadow have to be drawn over it, so they are kept
+        // out of the layer. They are stacked vertically, which makes them a contiguous range
+        size_t skip_begin = 0;
+        size_t skip_end = 0;
+        if (selection_mode == SelectionMode::SIDEBAR) {
+            const SDL_FRect &highlight_pos = sidebar_highlight->get_pos();
+            while (skip_begin < sidebar_entries.size() &&
+            !SDL_HasRectIntersectionFloat(&sidebar_entries[skip_begin].get_pos(), &highlight_pos))
+                skip_begin++;
+            skip_end = skip_begin;
+            while (skip_end < sidebar_entries.size() &&
+            SDL_HasRectIntersectionFloat(&sidebar_entries[skip_end].get_pos(), &highlight_pos))
+                skip_end++;
+            if (skip_begin == skip_end)
+                skip_begin = skip_end = 0;
+        }
+        if (skip_begin != static_layer_skip_begin || skip_end != static_layer_skip_end) {
+            static_layer_skip_begin = skip_begin;
+            static_layer_skip_end = skip_end;
+            static_layer_dirty = true;
+        }
+        if (static_layer_dirty) {
+            renderer->begin_layer(*static_layer);
+            draw_static(skip_begin, skip_end);
+            renderer->end_layer();
+            static_layer_dirty = false;
+        }
+        renderer->draw(*static_layer);
+
+        if (selection_mode == SelectionMode::SIDEBAR) {
+            renderer->set_clip_rect(sidebar_highlight_clip);
+            sidebar_highlight->draw();
+            renderer->set_clip_rect(sidebar_text_clip);
+            for (size_t i = skip_begin; i < skip_end; i++)
+                sidebar_entries[i].draw();
+        }
+    }
+    else {
+        if (background_texture)
+            renderer->draw(*background_texture);
+        if (selection_mode == SelectionMode::SIDEBAR) {
+            renderer->set_clip_rect(sidebar_highlight_clip);
+            sidebar_highlight->draw();
+        }
+        renderer->set_clip_rect(sidebar_text_clip);
+        for (BL::SidebarEntry &entry : sidebar_entries)
+            entry.draw();
     }
-    
-    // Draw sidebar texts
-    renderer->set_clip_rect(sidebar_text_clip);
-    for (BL::SidebarEntry &entry : sidebar_entries)
-        entry.draw();
 
     // Draw menu entries
     renderer->set_clip_rect(menu_clip);
     for (BL::Menu &menu : menus) {
         if (menu.is_visible(y_min, y_max))
-            menu.draw();
+            menu.draw(menu_clip);
     }
     renderer->disable_clip();
 
@@ -716,23 +1063,26 @@ void BL::Layout::draw()
     // Draw screensaver
     if (screensaver && screensaver->is_active())
         screensaver->draw();
-
-    // Output to screen
-    renderer->present();
+    redraw = false;
 }
 
 BL::Layout::Layout(const std::string &file, int w, int h, Launcher &launcher):
     screen_width(w),
     screen_height(h),
     launcher(launcher),
-    rasterizer(new BL::SVGRasterizer())
+    rasterizer(new BL::SVGRasterizer()),
+    texture_budget(static_cast<size_t>(config.texture_budget) << 20)
 {
     parse(file);
 }
 BL::Layout::~Layout()
 {
+    finish_rendering();
     delete error_texture;
+    delete placeholder_texture;
     delete background_texture;
+    delete static_layer;
+    delete menu_column;
     delete sidebar_highlight;
     delete menu_highlight;
     delete screensaver;
@@ -2,12 +2,16 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <atomic>
 #include <SDL3/SDL.h>
 #include "object.hpp"
+#include "animation_pool.hpp"
 
 namespace BL {
     class SVGRasterizer;
     class Menu;
+    class MenuColumn;
     class MenuEntry;
     class MenuHighlight;
     class SidebarHighlight;
@@ -17,6 +21,9 @@ namespace BL {
     class Screensaver;
     class Launcher;
     class Renderer;
+    class RenderPool;
+    class AssetCache;
+    class CardCache;
     class Layout {
         private:
             enum SelectionMode {
@@ -31,39 +38,43 @@ namespace BL {
             };
 
             struct Press {
-                MenuEntry *entry;
-                SDL_FRect original_rect;
-                float total;
-                float current;
-                float velocity;
-                Direction direction;
-                float aspect_ratio;
-                Uint64 ticks;
-
-                Press(MenuEntry &entry);
+                Menu *menu = nullptr;
+                size_t index = 0;
+                SDL_FRect original_rect{};
+                float total = 0.f;
+                float current = 0.f;
+                float velocity = 0.f;
+                Direction direction = Direction::RIGHT;
+                float aspect_ratio = 1.f;
+                Uint64 ticks = 0;
+
+                Press() = default;
+                Press(Menu &menu, size_t index);
                 ~Press() = default;
             };
 
+            // The type of a shift is also the handle of the object group it moves
             struct Shift {
                 enum Type {
                     SIDEBAR,
                     MENU,
-                    HIGHLIGHT
+                    HIGHLIGHT,
+                    NUM_TYPES
                 };
                 enum Method {
                     ABS,
                     REL
                 };
-                Type type;
-                Method method;
-                Direction direction;
-                Uint32 ticks;
-                float velocity;
-                float total;
-                float target;
-                std::vector<Object*> objects;
-                Shift(Type type, Method method, Direction direction, float velocity, float target, const std::vector<Object*> &objects):
-                    type(type), method(method), direction(direction), ticks(SDL_GetTicks()), velocity(velocity), total(0.f), target(target), objects(objects) {}
+                Type type = Type::SIDEBAR;
+                Method method = Method::REL;
+                Direction direction = Direction::UP;
+                Uint32 ticks = 0;
+                float velocity = 0.f;
+                float total = 0.f;
+                float target = 0.f;
+                Shift() = default;
+                Shift(Type type, Method method, Direction direction, float velocity, float target):
+                    type(type), method(method), direction(direction), ticks(SDL_GetTicks()), velocity(velocity), total(0.f), target(target) {}
                 ~Shift() = default;
             };
 
@@ -78,19 +89,44 @@ namespace BL {
             SDL_Surface *background_surface = nullptr;
             Texture *background_texture = nullptr;
 
+            // Background and sidebar texts, composed again when a text colour changes. The texts under
+            // the sidebar highlight are left out and drawn over it, the layer tracks which ones those are
+            Texture *static_layer = nullptr;
+            bool static_layer_dirty = true;
+            size_t static_layer_skip_begin = 0;
+            size_t static_layer_skip_end = 0;
+
             bool card_error = false;
-            SDL_Surface *error_bg = nullptr;
-            SDL_Surface *error_icon = nullptr;
-            SDL_FRect error_icon_rect;
+            SDL_Surface *error_surface = nullptr;
             Texture *error_texture = nullptr;
+            Texture *placeholder_texture = nullptr;
+
+            // Background card rendering
+            RenderPool *render_pool = nullptr;
+            AssetCache *assets = nullptr;
+            CardCache *card_cache = nullptr;
+            SDL_Surface *card_shadow = nullptr;
+            std::vector<std::atomic<int>> pending_cards; // per menu, unique cards that aren't rendered yet
+            int menus_pending = 0;
+
+            // Card texture residency
+            std::vector<Menu*> resident_menus;
+            size_t texture_budget;
+            bool textures_pending = false;
+
+            // Render on demand
+            bool redraw = true;
 
             // States
-            std::vector<Shift> shift_queue;
-            std::vector<Press> press_queue;
+            static constexpr size_t MAX_SHIFTS = 8;
+            static constexpr size_t MAX_PRESSES = 8;
+            AnimationPool<Shift, MAX_SHIFTS> shifts;
+            AnimationPool<Press, MAX_PRESSES> presses;
+            std::array<std::vector<Object*>, Shift::Type::NUM_TYPES> object_groups; // registered while loading
             SelectionMode selection_mode = SelectionMode::SIDEBAR;
             Menu *current_menu = nullptr;
             std::vector<Menu> menus;
-            std::vector<Object*> menu_objects;
+            MenuColumn *menu_column = nullptr;
 
             // Sidebar
             std::vector<SidebarEntry> sidebar_entries;
@@ -115,8 +151,6 @@ namespace BL {
             float card_y_advance;
             float card_spacing;
             int max_rows;
-            SDL_Surface *card_shadow = nullptr;
-            Texture *card_shadow_texture = nullptr;
             float card_shadow_offset;
             float y_leftover; // vertical spacing between the last row of cards and bottom of screen, when menu is fully extended
 
@@ -136,12 +170,25 @@ namespace BL {
             void load_sidebar();
             void load_menu_entires();
             void load_menu_highlight();
-            void render_error_surface();
+            void start_rendering(int misses);
+            void wait_for_menu(Menu &menu);
+            void set_menu_ready(size_t i);
+            void poll_menus();
+            void finish_rendering();
+            void render_error_surface(const SDL_Surface &shadow);
             void render_error_texture();
-            void add_shift(Shift::Type type, Direction direction, float target, float time, const std::vector<Object*> &objects, Shift::Method method = Shift::Method::REL);
-            void add_press(MenuEntry &entry) { press_queue.emplace_back(entry); }
+            void render_placeholder_texture();
+            void update_residency(Direction direction);
+            void evict_textures();
+            void upload_textures(int max_uploads);
+            void add_shift(Shift::Type type, Direction direction, float target, float time, Shift::Method method = Shift::Method::REL);
+            void add_press(Menu &menu, size_t index);
+            void apply_shift(Shift &shift, float change);
+            void finish_shift(Shift &shift);
+            void finish_press(Press &press);
             void update_shift();
             void update_press();
+            void draw_static(size_t skip_begin, size_t skip_end);
 
         public:
             Layout(const std::string &file, int w, int h, Launcher &launcher);
@@ -150,9 +197,15 @@ namespace BL {
             void load_surfaces();
             void load_textures(Renderer &renderer);
             void update();
+            bool is_loading() const { return menus_pending > 0; }
+            bool needs_redraw() const { return redraw; }
+            void request_redraw() { redraw = true; }
+            void invalidate_layers();
+            void wake_screensaver();
+            int get_wait_timeout() const;
             void draw();
-            void move_down();
-            void move_up();
+            void move_down(int steps = 1);
+            void move_up(int steps = 1);
             void move_left();
             void move_right();
             void select();
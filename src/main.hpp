@@ -3,6 +3,7 @@
 #include <SDL3/SDL.h>
 #include <string>
 #include <cmath>
+#include "command.hpp"
 
 
 #define DISPLAY_ASPECT_RATIO 1.77777778
@@ -17,6 +18,7 @@ namespace BL {
     class Gamepad;
     class Sound;
     class Config;
+    class StatsOverlay;
     class Launcher {
     private:
         struct Ticks {
@@ -32,6 +34,7 @@ namespace BL {
         Renderer *renderer = nullptr;
         Gamepad *gamepad = nullptr;
         Sound *sound = nullptr;
+        StatsOverlay *stats_overlay = nullptr;
         Ticks ticks{};
         State state;
         SDL_Window *window = nullptr;
@@ -40,6 +43,14 @@ namespace BL {
         int render_h = 0;
         bool letterbox = false;
         bool quit = false;
+        bool dry_run = false;
+
+        // Arrow key presses not yet passed to the layout
+        struct PendingMove {
+            SDL_Keycode key = SDLK_UNKNOWN;
+            int steps = 0;
+        };
+        PendingMove pending_move;
 
         void init_logging();
         void locate_files();
@@ -48,13 +59,23 @@ namespace BL {
         void debug_display();
         void pre_launch();
         void post_launch();
+        void wait_for_event();
+        void wait_for_application();
+        void queue_move(SDL_Keycode key);
+        void flush_moves();
 
     public:
         Launcher(const std::string &layout_path);
         ~Launcher();
 
         int run();
-        void execute_command(const std::string &command);
+        void update();
+        void process_events();
+        void draw();
+        void present();
+        bool is_loading() const;
+        void set_dry_run(bool dry_run) { this->dry_run = dry_run; }
+        void execute_command(const Command &command);
         void play_click();
         void play_select();
         Uint64 current_time() const { return ticks.main; }
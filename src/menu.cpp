@@ -1,16 +1,20 @@
 #include <string>
 #include <memory>
+#include <algorithm>
+#include <cmath>
 
 #include <SDL3/SDL.h>
 #include <libxml/xmlmemory.h>
 #include <libxml/parser.h>
 #include "logger.hpp"
-#include "external/nanosvg.h"
 
 #include "menu.hpp"
+#include "card_cache.hpp"
+#include "asset_cache.hpp"
 #include "image.hpp"
 #include "util.hpp"
 #include "renderer.hpp"
+#include "profiler.hpp"
 
 namespace BL {
     void free_xml_char(xmlChar *c);
@@ -20,14 +24,15 @@ namespace BL {
 }
 
 BL::MenuEntry::MenuEntry(const std::string &title, const std::string &command):
-    BL::Drawable(),
     title(title),
     command(command),
     icon_margin(BL::CARD_ICON_MARGIN)
 {}
+
 BL::MenuEntry::~MenuEntry()
 {
-    BL::free_surface(icon_surface);
+    BL::free_surface(surface);
+    delete texture;
 }
 
 // Custom card
@@ -65,18 +70,48 @@ void BL::MenuEntry::set_margin(const char *value)
     icon_margin = percent;
 }
 
-bool BL::MenuEntry::render_surface(BL::SVGRasterizer &rasterizer, float w, float h, float shadow_offset)
+void BL::MenuEntry::set_geometry(float w, float h, float shadow_offset)
 {
+    card_w = w;
+    card_h = h;
     this->shadow_offset = shadow_offset;
-    set_w(w);
-    set_h(h);
+}
+
+// Content key of the card, identical cards share one surface and texture
+void BL::MenuEntry::update_card_key()
+{
+    card_key = BL::Hasher()
+                   .add(card_type)
+                   .add_file(path)
+                   .add_file(icon_path)
+                   .add(icon_margin)
+                   .add(background_color)
+                   .get();
+}
+
+bool BL::MenuEntry::load_cached_surface(BL::CardCache &cache)
+{
+    surface = cache.load(card_key, 
+                  static_cast<int>(std::round(card_w + 2.f * shadow_offset)), 
+                  static_cast<int>(std::round(card_h + 2.f * shadow_offset))
+              );
+    return surface != nullptr;
+}
+
+bool BL::MenuEntry::render_surface(BL::SVGRasterizer &rasterizer, const SDL_Surface &shadow, BL::CardCache *cache, BL::AssetCache &assets)
+{
+    float w = card_w;
+    float h = card_h;
+    int background_w = static_cast<int>(std::round(w));
+    int background_h = static_cast<int>(std::round(h));
+    const SDL_Surface *background = nullptr;
+    const SDL_Surface *icon = nullptr;
+    SDL_Rect icon_rect;
 
     // Custom card
     if (card_type == BL::MenuEntry::CardType::CUSTOM) {
-        surface = (path.ends_with(".svg")) 
-                                ? rasterizer.rasterize_svg_from_file(path, w, h)
-                                : BL::load_surface(path);
-        if (!surface) {
+        background = assets.get_surface(rasterizer, path, background_w, background_h);
+        if (!background) {
             BL::logger::error("Failed to load card '{}'", path);
             return false;
         }
@@ -85,48 +120,18 @@ bool BL::MenuEntry::render_surface(BL::SVGRasterizer &rasterizer, float w, float
     // Generated card
     else {
         if (!path.empty()) {
-            surface = (path.ends_with(".svg")) 
-                    ? rasterizer.rasterize_svg_from_file(path, w, h)
-                    : BL::load_surface(path);
-            if (!surface) {
+            background = assets.get_surface(rasterizer, path, background_w, background_h);
+            if (!background) {
                 BL::logger::error("Failed to load card background '{}'", path);
                 return false;
             }
         }
 
-        // Color background
-        if (!surface) {
-            surface = SDL_CreateSurface(std::round(w), std::round(h), SDL_PIXELFORMAT_RGBA32);
-            Uint32 color = SDL_MapSurfaceRGBA(surface, 
-                                background_color.r, 
-                                background_color.g, 
-                                background_color.b, 
-                                background_color.a
-                            );
-            SDL_FillSurfaceRect(surface, nullptr, color);
-        }
-
-        // Calculate aspect ratio, load surface if non-SVG
+        // Calculate aspect ratio
         float aspect_ratio, icon_w, icon_h;
-        bool svg = icon_path.ends_with(".svg");
-        NSVGimage *image = nullptr;
-        if (svg) {
-            image = rasterizer.parse_from_file(icon_path.c_str(), "px", 96.0f);
-            if (!image) {
-                BL::logger::error("Failed to load card icon '{}'", icon_path);
-                return false;
-            }
-            icon_w = image->width;
-            icon_h = image->height;
-        }
-        else {
-            icon_surface = BL::load_surface(icon_path);
-            if (!icon_surface) {
-                BL::logger::error("Failed to load card icon '{}'", icon_path);
-                return false;
-            }
-            icon_w = static_cast<float>(icon_surface->w);
-            icon_h = static_cast<float>(icon_surface->h);
+        if (!assets.get_size(rasterizer, icon_path, icon_w, icon_h)) {
+            BL::logger::error("Failed to load card icon '{}'", icon_path);
+            return false;
         }
         aspect_ratio = icon_w / icon_h;
         float target_w, target_h;
@@ -136,65 +141,98 @@ bool BL::MenuEntry::render_surface(BL::SVGRasterizer &rasterizer, float w, float
             target_w = w  * (1.0f - 2.0f * icon_margin);
             target_h = ((target_w / icon_w)) * icon_h;
             icon_rect =  {
-                std::round(icon_margin * w) + shadow_offset,
-                std::round((h - target_h) / 2 + shadow_offset),
-                std::round(target_w),
-                std::round(target_h)
+                static_cast<int>(std::round(icon_margin * w) + shadow_offset),
+                static_cast<int>(std::round((h - target_h) / 2 + shadow_offset)),
+                static_cast<int>(std::round(target_w)),
+                static_cast<int>(std::round(target_h))
             };
         }
         else {
             target_h = h  * (1.0f - 2.0f * icon_margin);
             target_w = (target_h / icon_h) * icon_w;
             icon_rect = {
-                std::round((w - target_w) / 2 + shadow_offset),
-                std::round(icon_margin * h) + shadow_offset,
-                std::round(target_w),
-                std::round(target_h)
+                static_cast<int>(std::round((w - target_w) / 2 + shadow_offset)),
+                static_cast<int>(std::round(icon_margin * h) + shadow_offset),
+                static_cast<int>(std::round(target_w)),
+                static_cast<int>(std::round(target_h))
             };
         }
-        if (svg) {
-            icon_surface = rasterizer.rasterize_svg_image(image, icon_rect.w, icon_rect.h);
-            if (!icon_surface) {
-                BL::logger::error("Failed to load card icon '{}'", icon_path);
-                return false;
-            }
+        icon = assets.get_surface(rasterizer, icon_path, icon_rect.w, icon_rect.h);
+        if (!icon) {
+            BL::logger::error("Failed to load card icon '{}'", icon_path);
+            return false;
         }
     }
 
+    // Composit shadow, background and icon into the final card
+    surface = BL::copy_surface(shadow);
+    int offset = static_cast<int>(shadow_offset);
+    if (background)
+        BL::blend_surface(*background, *surface, offset, offset);
+    else {
+        SDL_Surface *color_background = SDL_CreateSurface(background_w, background_h, SDL_PIXELFORMAT_RGBA32);
+        Uint32 color = SDL_MapSurfaceRGBA(color_background, 
+                           background_color.r, 
+                           background_color.g, 
+                           background_color.b, 
+                           background_color.a
+                       );
+        SDL_FillSurfaceRect(color_background, nullptr, color);
+        BL::blend_surface(*color_background, *surface, offset, offset);
+        BL::free_surface(color_background);
+    }
+    if (icon)
+        BL::blend_surface(*icon, *surface, icon_rect.x, icon_rect.y);
+
+    if (cache)
+        cache->store(card_key, *surface);
     return true;
 }
 
-void BL::MenuEntry::render_texture(Texture &shadow_texture, float shadow_offset, float card_w, float card_h)
+// The composed surface is kept, so the texture can be evicted and uploaded again later.
+// Shared cards are uploaded once and counted by every entry showing them, returns the bytes uploaded
+size_t BL::MenuEntry::render_texture(BL::Renderer &renderer)
 {
-    texture = renderer->create_texture(std::round(pos.w), std::round(pos.h));
-    
-    // Copy the shadow
-    renderer->composit_texture(shadow_texture, *texture, nullptr);
+    if (source)
+        return source->render_texture(renderer);
+    if (texture_refs++)
+        return 0;
+    texture = renderer.create_atlas_texture(*surface);
+    return get_texture_bytes();
+}
 
-    // Copy the background
-    BL::Texture *background_texture = renderer->create_texture(*surface);
-    SDL_FRect rect = {shadow_offset, shadow_offset, card_w, card_h};
-    renderer->composit_texture(*background_texture, *texture, &rect);
-    BL::free_surface(surface);
-    surface = nullptr;
-    delete background_texture;   
-
-    // Copy the icon
-    if (card_type == BL::MenuEntry::CardType::GENERATED) {
-        BL::Texture *icon_texture = renderer->create_texture(*icon_surface);
-        renderer->composit_texture(*icon_texture, *texture, &icon_rect);
-        BL::free_surface(icon_surface);
-        icon_surface = nullptr;
-        delete icon_texture;           
+void BL::MenuEntry::unload_texture()
+{
+    if (source) {
+        source->unload_texture();
+        return;
+    }
+    if (texture_refs && --texture_refs == 0) {
+        delete texture;
+        texture = nullptr;
     }
 }
 
+void BL::CardTable::resize(size_t n)
+{
+    x.resize(n);
+    y.resize(n);
+    w.resize(n);
+    h.resize(n);
+    textures.resize(n, nullptr);
+    errors.resize(n, 0);
+}
+
 BL::Menu::Menu(const std::string &title, int nb_columns):
     BL::Object(),
     title(title),
     nb_columns(nb_columns)
 {}
-BL::Menu::~Menu() = default;
+
+BL::Menu::~Menu()
+{
+    delete grid_layer;
+}
 
 bool BL::Menu::parse(xmlNodePtr node)
 {
@@ -211,6 +249,7 @@ bool BL::Menu::parse(xmlNodePtr node)
     total_rows = num_entries / max_columns;
     if (num_entries % max_columns)
         total_rows++;
+    cards.resize(entry_list.size());
 
     return true;
 }
@@ -308,98 +347,230 @@ void BL::Menu::add_entry(xmlNodePtr node)
     entry_list.emplace_back(std::move(*entry));
 }
 
-bool BL::Menu::render_surfaces(BL::SVGRasterizer &rasterizer, float w, float h, float shadow_offset)
+// Entries with the same card as an earlier one share its surface, returns the number of unique cards that weren't cached
+int BL::Menu::load_cached_surfaces(BL::CardCache *cache, float w, float h, float shadow_offset, std::unordered_map<Uint64, BL::MenuEntry*> &unique_cards)
 {
-    bool ret = true;
+    int misses = 0;
+    this->shadow_offset = shadow_offset;
+    std::fill(cards.w.begin(), cards.w.end(), w + 2.f * shadow_offset);
+    std::fill(cards.h.begin(), cards.h.end(), h + 2.f * shadow_offset);
     for (MenuEntry &entry : entry_list) {
-        if(!entry.render_surface(rasterizer, w, h, shadow_offset)) {
-            entry.set_card_error(true);
-            ret = false;
+        entry.set_geometry(w, h, shadow_offset);
+        entry.update_card_key();
+        auto [it, inserted] = unique_cards.try_emplace(entry.get_card_key(), &entry);
+        if (!inserted) {
+            entry.set_source(*it->second);
+            continue;
         }
+        if (!cache || !entry.load_cached_surface(*cache))
+            misses++;
     }
-    return ret;
+    return misses;
 }
 
-void BL::Menu::render_card_textures(Texture &card_shadow_texture, float shadow_offset, float card_w, float card_h)
+// Unique cards shown by this menu that have no surface yet
+std::vector<BL::MenuEntry*> BL::Menu::get_unrendered_cards()
 {
+    std::vector<MenuEntry*> cards;
     for (MenuEntry &entry : entry_list) {
-        entry.set_renderer(*renderer);
-        if (!entry.get_card_error())
-            entry.render_texture(card_shadow_texture, shadow_offset, card_w, card_h);
+        MenuEntry &card = entry.get_card();
+        if (!card.has_surface() && std::find(cards.begin(), cards.end(), &card) == cards.end())
+            cards.push_back(&card);
     }
+    return cards;
 }
 
-void BL::Menu::draw()
+bool BL::Menu::has_card_error() const
 {
-    for (MenuEntry &entry : entry_list)
-        if (entry.get_card_error()) {
-            error_texture->update_pos(entry.get_pos());
-            renderer->draw(*error_texture);
-        }
-        else
-            entry.draw();
+    return std::any_of(entry_list.begin(), entry_list.end(), [](const MenuEntry &entry){ return entry.get_card_error(); });
 }
 
-void BL::Menu::print_entries()
+// Card errors are final once the menu is ready, so they are copied into the card table
+void BL::Menu::set_ready(bool ready)
 {
-    for (MenuEntry &entry : entry_list) {
-        BL::logger::debug("Entry {}:", &entry - &entry_list[0]);
-        BL::logger::debug("Title: {}", entry.get_title());
-        BL::logger::debug("Command: {}", entry.get_command());
+    this->ready = ready;
+    grid_dirty = true;
+    if (ready) {
+        for (size_t i = 0; i < entry_list.size(); i++)
+            cards.errors[i] = entry_list[i].get_card_error();
     }
 }
 
-void BL::Menu::set_x(float x)
+// Visual rect of a card without its shadow, in menu coordinates
+SDL_FRect BL::Menu::get_card_rect(size_t i) const
 {
-    float x_start = x;
-    int col = 0;
-    for (MenuEntry &entry : entry_list) {
-        entry.set_x(x);
-        col++;
-        if (col == nb_columns) {
-            x = x_start;
-            col = 0;
-        }
-        else
-            x += x_advance;
+    return {
+        cards.x[i] + shadow_offset,
+        cards.y[i] + shadow_offset,
+        cards.w[i] - 2.f * shadow_offset,
+        cards.h[i] - 2.f * shadow_offset
+    };
+}
+
+void BL::Menu::set_card_rect(size_t i, const SDL_FRect &rect)
+{
+    cards.x[i] = rect.x - shadow_offset;
+    cards.y[i] = rect.y - shadow_offset;
+    cards.w[i] = rect.w + 2.f * shadow_offset;
+    cards.h[i] = rect.h + 2.f * shadow_offset;
+}
+
+// Uploads up to max_uploads card textures, returns the number of textures that were uploaded
+int BL::Menu::load_textures(int max_uploads)
+{
+    int uploads = 0;
+    if (!ready)
+        return uploads;
+    for (; loaded_entries < entry_list.size() && uploads < max_uploads; loaded_entries++) {
+        MenuEntry &entry = entry_list[loaded_entries];
+        if (cards.errors[loaded_entries])
+            continue;
+        BL::EntryProfileScope scope(entry.get_title(), title, "render_texture");
+        texture_bytes += entry.render_texture(*renderer);
+        cards.textures[loaded_entries] = entry.get_texture();
+        uploads++;
     }
+    if (uploads)
+        grid_dirty = true;
+    return uploads;
 }
 
-void BL::Menu::set_y(float y)
+void BL::Menu::unload_textures()
 {
-    float y_start = y;
-    int col = 0;
-    for (MenuEntry &entry : entry_list) {
-        entry.set_y(y);
-        col++;
-        if (col == nb_columns) {
-            y += y_advance;
-            col = 0;
+    for (size_t i = 0; i < loaded_entries; i++) {
+        if (cards.textures[i]) {
+            entry_list[i].unload_texture();
+            cards.textures[i] = nullptr;
         }
     }
+    delete_grid_layer();
+    grid_dirty = true;
+    loaded_entries = 0;
+    texture_bytes = 0;
+}
+
+size_t BL::Menu::get_missing_texture_bytes() const
+{
+    size_t bytes = 0;
+    if (!ready)
+        return bytes;
+    for (size_t i = loaded_entries; i < entry_list.size(); i++)
+        bytes += entry_list[i].get_texture_bytes();
+    return bytes;
+}
+
+void BL::Menu::delete_grid_layer()
+{
+    if (grid_layer) {
+        texture_bytes -= static_cast<size_t>(grid_layer->get_w() * grid_layer->get_h()) * 4;
+        delete grid_layer;
+        grid_layer = nullptr;
+    }
+}
+
+// Composes every card into the grid layer if it is out of date, returns false if the menu can't be cached
+bool BL::Menu::update_grid_layer()
+{
+    if (!grid_dirty)
+        return grid_layer != nullptr;
+    grid_dirty = false;
+
+    float x1 = cards.x[0], y1 = cards.y[0], x2 = x1, y2 = y1;
+    for (size_t i = 0; i < cards.size(); i++) {
+        x1 = std::min(x1, cards.x[i]);
+        y1 = std::min(y1, cards.y[i]);
+        x2 = std::max(x2, cards.x[i] + cards.w[i]);
+        y2 = std::max(y2, cards.y[i] + cards.h[i]);
+    }
+    SDL_FRect bounds = {x1, y1, x2 - x1, y2 - y1};
+    int w = static_cast<int>(std::ceil(bounds.w));
+    int h = static_cast<int>(std::ceil(bounds.h));
+    if (grid_layer && (grid_layer->get_w() != w || grid_layer->get_h() != h))
+        delete_grid_layer();
+    if (!grid_layer) {
+        if (w > renderer->get_max_layer_size() || h > renderer->get_max_layer_size())
+            return false;
+        grid_layer = renderer->create_layer(w, h);
+        if (!grid_layer)
+            return false;
+        texture_bytes += static_cast<size_t>(w * h) * 4;
+    }
+
+    grid_pos = {bounds.x, bounds.y};
+    renderer->begin_layer(*grid_layer);
+    for (size_t i = 0; i < cards.size(); i++) {
+        Texture *texture = cards.errors[i] ? error_texture : cards.textures[i];
+        texture->update_pos({cards.x[i] - bounds.x, cards.y[i] - bounds.y, cards.w[i], cards.h[i]});
+        renderer->draw(*texture);
+    }
+    renderer->end_layer();
+    return true;
 }
 
-void BL::Menu::inc_x(float x)
+// Only the rows overlapping the clip rect are drawn. Rows are y_advance apart, a pressed card
+// moves within its row, so one row of margin on each side covers it
+void BL::Menu::draw(const SDL_Rect &clip)
 {
-    for (MenuEntry &entry : entry_list)
-        entry.inc_x(x);
+    // Once every card is uploaded the grid scrolls as a single texture
+    float offset_x = get_offset_x();
+    float offset_y = get_offset_y();
+    if (textures_loaded() && !presses && update_grid_layer()) {
+        grid_layer->set_x(grid_pos.x);
+        grid_layer->set_y(grid_pos.y);
+        renderer->set_translation(offset_x, offset_y);
+        renderer->draw(*grid_layer);
+        renderer->set_translation(0.f, 0.f);
+        return;
+    }
 
+    size_t begin = 0;
+    size_t end = entry_list.size();
+    if (y_advance > 0.f) {
+        float y1 = static_cast<float>(clip.y) - offset_y;
+        float y2 = static_cast<float>(clip.y + clip.h) - offset_y;
+        int first_row = static_cast<int>(std::floor((y1 - cards.y[0] - cards.h[0]) / y_advance)) - 1;
+        int last_row = static_cast<int>(std::floor((y2 - cards.y[0]) / y_advance)) + 1;
+        begin = static_cast<size_t>(std::clamp(first_row, 0, total_rows)) * nb_columns;
+        end = std::min(static_cast<size_t>(std::clamp(last_row + 1, 0, total_rows)) * nb_columns, entry_list.size());
+    }
+
+    renderer->set_translation(offset_x, offset_y);
+    for (size_t i = begin; i < end; i++) {
+        Texture *texture;
+        if (!ready)
+            texture = placeholder_texture;
+        else if (cards.errors[i])
+            texture = error_texture;
+        else if (!cards.textures[i])
+            texture = placeholder_texture;
+        else
+            texture = cards.textures[i];
+        texture->update_pos(cards.get_rect(i));
+        renderer->draw(*texture);
+    }
+    renderer->set_translation(0.f, 0.f);
 }
 
-void BL::Menu::dec_x(float x)
+void BL::Menu::print_entries()
 {
-    for (MenuEntry &entry : entry_list)
-        entry.dec_x(x);
+    for (MenuEntry &entry : entry_list) {
+        BL::logger::debug("Entry {}:", &entry - &entry_list[0]);
+        BL::logger::debug("Title: {}", entry.get_title());
+        BL::logger::debug("Command: {}", entry.get_command().get_line());
+    }
 }
 
-void BL::Menu::inc_y(float y)
+// Lays out the cards from the menu origin and moves the origin to x
+void BL::Menu::set_x(float x)
 {
-    for (MenuEntry &entry : entry_list)
-        entry.inc_y(y);
+    for (size_t i = 0; i < cards.size(); i++)
+        cards.x[i] = static_cast<float>(i % nb_columns) * x_advance - shadow_offset;
+    offset.x = x - (menu_column ? menu_column->get_x() : 0.f);
 }
 
-void BL::Menu::dec_y(float y)
+void BL::Menu::set_y(float y)
 {
-    for (MenuEntry &entry : entry_list)
-        entry.dec_y(y);
+    for (size_t i = 0; i < cards.size(); i++)
+        cards.y[i] = static_cast<float>(i / nb_columns) * y_advance - shadow_offset;
+    offset.y = y - (menu_column ? menu_column->get_y() : 0.f);
 }
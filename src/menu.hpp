@@ -2,11 +2,13 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include <SDL3/SDL.h>
 #include <libxml/parser.h>
 
-#include "drawable.hpp"
+#include "object.hpp"
+#include "command.hpp"
 #include "util.hpp"
 
 namespace BL {
@@ -14,7 +16,10 @@ namespace BL {
     class Texture;
     class SVGRasterizer;
     class Renderer;
-    class MenuEntry: public Drawable {
+    class CardCache;
+    class AssetCache;
+    // Cold per entry data, the card's position is kept in the menu's CardTable
+    class MenuEntry {
     public:
         enum CardType {
             CUSTOM,
@@ -24,14 +29,20 @@ namespace BL {
     private:
         CardType card_type;
         std::string title;
-        std::string command;
+        Command command;
         SDL_Color background_color { 0xFF, 0xFF, 0xFF, 0xFF };
         std::string path; // doubles for both card path and background in generated mode
         std::string icon_path;
-        SDL_Surface *icon_surface = nullptr;
-        SDL_FRect icon_rect;
         float icon_margin;
+        float card_w = 0.f;
+        float card_h = 0.f;
+        float shadow_offset = 0.f;
+        Uint64 card_key = 0;
         bool card_error = false;
+        SDL_Surface *surface = nullptr;
+        Texture *texture = nullptr;
+        MenuEntry *source = nullptr; // identical card whose surface and texture are shared
+        int texture_refs = 0;
     
     public:
         MenuEntry(const std::string &title, const std::string &command);
@@ -41,19 +52,72 @@ namespace BL {
         void set_card(SDL_Color &background_color, const std::string &path);
         void set_card(const std::string &background_path, const std::string &icon_path);
         void set_card_error(bool card_error) { this->card_error = card_error; }
-        bool get_card_error() const { return card_error; }
+        bool get_card_error() const { return source ? source->card_error : card_error; }
         void set_margin(const char *value);
-        bool render_surface(SVGRasterizer &rasterizer, float w, float h, float shadow_offset);
-        void render_texture(Texture &shadow_texture, float card_w, float card_h, float shadow_offset);
-        const std::string& get_command() const { return command; }
+        void set_geometry(float w, float h, float shadow_offset);
+        void update_card_key();
+        Uint64 get_card_key() const { return card_key; }
+        void set_source(MenuEntry &source) { this->source = &source; }
+        bool has_source() const { return source != nullptr; }
+        MenuEntry& get_card() { return source ? *source : *this; }
+        bool load_cached_surface(CardCache &cache);
+        bool has_surface() const { return source ? source->has_surface() : surface != nullptr; }
+        bool render_surface(SVGRasterizer &rasterizer, const SDL_Surface &shadow, CardCache *cache, AssetCache &assets);
+        size_t render_texture(Renderer &renderer);
+        void unload_texture();
+        Texture* get_texture() { return source ? source->get_texture() : texture; }
+        size_t get_texture_bytes() const
+        {
+            if (source)
+                return source->get_texture_bytes();
+            return surface ? static_cast<size_t>(surface->w) * surface->h * 4 : 0;
+        }
+        const Command& get_command() const { return command; }
         const std::string& get_title() const { return title; }
     };
 
+    // Hot per entry card data in parallel arrays, so bulk moves and visibility tests are plain loops.
+    // Rects include the card shadow and are in menu coordinates
+    struct CardTable {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> w;
+        std::vector<float> h;
+        std::vector<Texture*> textures; // nullptr until uploaded
+        std::vector<Uint8> errors;
+
+        size_t size() const { return x.size(); }
+        void resize(size_t n);
+        SDL_FRect get_rect(size_t i) const { return {x[i], y[i], w[i], h[i]}; }
+    };
+
+    // Translation shared by every menu, scrolling the menu column only moves this offset
+    class MenuColumn: public Object {
+    private:
+        SDL_FPoint offset{};
+
+    public:
+        MenuColumn(): Object() {}
+        float get_x() const override final { return offset.x; }
+        void set_x(float x) override final { offset.x = x; }
+        float get_y() const override final { return offset.y; }
+        void set_y(float y) override final { offset.y = y; }
+        float get_w() const override final { return 0.f; }
+        float get_h() const override final { return 0.f; }
+        void inc_x(float x) override final { offset.x += x; }
+        void dec_x(float x) override final { offset.x -= x; }
+        void inc_y(float y) override final { offset.y += y; }
+        void dec_y(float y) override final { offset.y -= y; }
+    };
+
+    // Entries are positioned in menu coordinates, the menu and column offsets are applied when drawing
     class Menu: public Object {
     private:
         std::string title;
         void add_entry(xmlNodePtr node);
         std::vector<MenuEntry> entry_list;
+        CardTable cards;
+        float shadow_offset = 0.f;
         int row = 0;
         int column = 0;
         int total_rows = 0;
@@ -64,8 +128,24 @@ namespace BL {
         float y_advance = 0.f;
         int shift_count = 0;
         Texture *error_texture = nullptr; // owned by Layout
+        Texture *placeholder_texture = nullptr; // owned by Layout
+        size_t loaded_entries = 0;
+        size_t texture_bytes = 0;
+        Uint64 last_used = 0;
+        bool ready = true; // false while cards are still being rendered in the background
         std::vector<MenuEntry>::iterator current_entry;
         Renderer *renderer = nullptr;
+        const MenuColumn *menu_column = nullptr;
+        SDL_FPoint offset{};
+
+        // Cached card grid, drawn per entry instead while a card is pressed
+        Texture *grid_layer = nullptr;
+        SDL_FPoint grid_pos{}; // position of the layer in menu coordinates
+        bool grid_dirty = true;
+        int presses = 0;
+
+        bool update_grid_layer();
+        void delete_grid_layer();
 
     public:
         Menu(const std::string &title, int nb_columns);
@@ -74,12 +154,33 @@ namespace BL {
         const std::string& get_title() const { return title; }
         size_t num_entries() { return entry_list.size(); }
         void set_renderer(Renderer &renderer) { this->renderer = &renderer; }
-        bool render_surfaces(BL::SVGRasterizer &rasterizer, float shadow_offset, float w, float h);
-        void render_card_textures(Texture &card_shadow_texture, float shadow_offset, float card_w, float card_h);
-        void draw();
+        void set_column(const MenuColumn &column) { menu_column = &column; }
+        float get_offset_x() const { return offset.x + (menu_column ? menu_column->get_x() : 0.f); }
+        float get_offset_y() const { return offset.y + (menu_column ? menu_column->get_y() : 0.f); }
+        int load_cached_surfaces(CardCache *cache, float w, float h, float shadow_offset, std::unordered_map<Uint64, MenuEntry*> &unique_cards);
+        std::vector<MenuEntry*> get_unrendered_cards();
+        bool has_card_error() const;
+        bool is_ready() const { return ready; }
+        void set_ready(bool ready);
+        int load_textures(int max_uploads);
+        void unload_textures();
+        bool textures_loaded() const { return ready && loaded_entries == entry_list.size(); }
+        size_t get_texture_bytes() const { return texture_bytes; }
+        size_t get_missing_texture_bytes() const;
+        Uint64 get_last_used() const { return last_used; }
+        void set_last_used(Uint64 last_used) { this->last_used = last_used; }
+        void draw(const SDL_Rect &clip);
         void print_entries();
-        void set_error_texture(Texture &error_texture) { this-> error_texture = &error_texture; }
+        void set_error_texture(Texture &error_texture) { this-> error_texture = &error_texture; grid_dirty = true; }
+        void invalidate_grid_layer() { grid_dirty = true; }
+        void set_placeholder_texture(Texture &placeholder_texture) { this->placeholder_texture = &placeholder_texture; }
+        void begin_press() { presses++; }
+        void end_press() { presses--; }
         MenuEntry& get_current_entry() { return *current_entry; }
+        size_t get_current_index() { return static_cast<size_t>(current_entry - entry_list.begin()); }
+        MenuEntry& get_entry(size_t i) { return entry_list[i]; }
+        SDL_FRect get_card_rect(size_t i) const;
+        void set_card_rect(size_t i, const SDL_FRect &rect);
         int get_row() const { return row; }
         void inc_row() { row++; current_entry += max_columns; }
         void dec_row() { row--; current_entry -= max_columns; }
@@ -93,16 +194,16 @@ namespace BL {
         void inc_shift_count() { shift_count++; }
         void dec_shift_count() { shift_count--; }
         void reset_shift_count() { shift_count = 0; }
-        float get_x() const override final { return entry_list[0].get_x(); }
+        float get_x() const override final { return cards.x[0] + shadow_offset + get_offset_x(); }
         void set_x(float x) override final;
-        float get_y() const override final { return entry_list[0].get_y(); }
+        float get_y() const override final { return cards.y[0] + shadow_offset + get_offset_y(); }
         void set_y(float y) override final;
-        float get_w() const override final { return entry_list[max_columns - 1].get_x() + entry_list[max_columns - 1].get_w() - entry_list[0].get_x(); }
-        float get_h() const override final { return entry_list.back().get_y() + entry_list.back().get_h() - entry_list[0].get_y(); }
-        void inc_x(float x) override final;
-        void dec_x(float x) override final;
-        void inc_y(float y) override final;
-        void dec_y(float y) override final;
+        float get_w() const override final { return cards.x[max_columns - 1] + cards.w[max_columns - 1] - cards.x[0] - 2.f * shadow_offset; }
+        float get_h() const override final { return cards.y.back() + cards.h.back() - cards.y[0] - 2.f * shadow_offset; }
+        void inc_x(float x) override final { offset.x += x; }
+        void dec_x(float x) override final { offset.x -= x; }
+        void inc_y(float y) override final { offset.y += y; }
+        void dec_y(float y) override final { offset.y -= y; }
         void set_x_advance(float x_advance) { this->x_advance = x_advance; }
         void set_y_advance(float y_advance) { this->y_advance = y_advance; }
         bool is_visible(float y1, float y2)
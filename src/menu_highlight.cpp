@@ -53,7 +53,9 @@ void BL::MenuHighlight::render_surface(BL::SVGRasterizer &rasterizer, int w, int
         {0, std::round(max_y_offset),     std::round(max_blur),        alpha}
     };
 
-    surface = BL::create_shadow(highlight, box_shadows, shadow_offset);
+    BL::RoundedRect shadow_box = {w, h, static_cast<float>(rx_outter)};
+    surface = shadow_box.has_closed_form() ? BL::create_shadow(shadow_box, box_shadows, shadow_offset)
+                                           : BL::create_shadow(highlight, box_shadows, shadow_offset);
     SDL_Rect blit_rect = {
         static_cast<int>(std::round(shadow_offset)),
         static_cast<int>(std::round(shadow_offset)),
@@ -2,9 +2,12 @@
 
 #include <string>
 #include <SDL3/SDL.h>
+#include "../command.hpp"
 
-bool start_process(const std::string &command, bool application);
+bool start_process(const BL::Command &command, bool application);
 bool process_running();
+bool supervise_processes();
+bool processes_need_polling();
 
 #ifdef __unix__
 #define scmd_shutdown() start_process("systemctl poweroff", false)
@@ -1,61 +1,243 @@
 #include <unistd.h>
+#include <spawn.h>
+#include <poll.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
 #include <signal.h>
+#include <cstring>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include <SDL3/SDL.h>
 #include "../logger.hpp"
 #include "platform.hpp"
 
-pid_t child_pid;
+extern char **environ;
 
-// A function to launch an external application
-bool start_process(const std::string &command, bool application)
+// Launched processes that haven't been reaped yet. Children with a pidfd are reaped by the
+// supervisor thread, the others are checked with waitpid from the event loop
+struct Child {
+    pid_t pid;
+    int pidfd; // -1 if the kernel has no pidfd support, owned by the supervisor thread otherwise
+    bool shell; // exit statuses 126 and 127 only mean the command could not be run when the shell reports them
+    bool exited = false;
+    int status = 0;
+};
+static std::mutex children_mutex;
+static std::vector<Child> children;
+static pid_t application_pid = -1;
+
+// Blocks on the pidfds of the children and wakes the SDL event queue when one exits,
+// so the event loop can sleep without a timeout while processes are running
+class Supervisor {
+private:
+    std::thread thread;
+    int wake_fd = -1; // makes the thread pick up new children or stop
+    std::atomic<bool> stopping = false;
+    Uint32 exit_event = 0;
+
+    void run();
+
+public:
+    ~Supervisor();
+    bool start();
+    void wake();
+};
+static Supervisor supervisor;
+
+static int open_pidfd(pid_t pid)
 {
-    child_pid = fork();
-    switch(child_pid) {
-        case -1:
-            BL::logger::error("Could not fork new process");
-            return false;
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    return -1;
+#endif
+}
 
-        // Child process
-        case 0:
-            {
-                const char *file = "/bin/sh";
-                const char *args[] = {
-                    "sh",
-                    "-c", 
-                    command.c_str(), 
-                    nullptr
-                };
-                execvp(file, (char* const*) args);
-            }
-            break;
+Supervisor::~Supervisor()
+{
+    if (!thread.joinable())
+        return;
+    stopping = true;
+    wake();
+    thread.join();
+    close(wake_fd);
+}
 
-        // Parent process
-        default:
-            if (!application) 
-                return true;
-            int status;
+bool Supervisor::start()
+{
+    if (thread.joinable())
+        return true;
+    wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd == -1)
+        return false;
+    exit_event = SDL_RegisterEvents(1);
+    thread = std::thread(&Supervisor::run, this);
+    return true;
+}
 
-            // Check to see if the shell successfully launched
-            SDL_Delay(50);
-            waitpid(child_pid, &status, WNOHANG);
-            if (WIFEXITED(status) && WEXITSTATUS(status) > 126)
-                return false;
-            break;
+void Supervisor::wake()
+{
+    uint64_t value = 1;
+    if (write(wake_fd, &value, sizeof(value)) == -1)
+        BL::logger::error("Could not wake process supervisor: {}", std::strerror(errno));
+}
+
+void Supervisor::run()
+{
+    std::vector<pollfd> fds;
+    std::vector<pid_t> pids;
+    while (!stopping) {
+        fds.assign(1, {wake_fd, POLLIN, 0});
+        pids.assign(1, 0);
+        {
+            std::lock_guard lock(children_mutex);
+            for (const Child &child : children) {
+                if (child.pidfd != -1 && !child.exited) {
+                    fds.push_back({child.pidfd, POLLIN, 0});
+                    pids.push_back(child.pid);
+                }
+            }
+        }
+        if (poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            BL::logger::error("Process supervisor stopped: {}", std::strerror(errno));
+            return;
+        }
+        if (fds[0].revents) {
+            uint64_t value;
+            if (read(wake_fd, &value, sizeof(value)) == -1)
+                BL::logger::error("Could not read process supervisor wakeup: {}", std::strerror(errno));
+        }
+
+        bool exited = false;
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (!fds[i].revents)
+                continue;
+            int status = 0;
+            waitpid(pids[i], &status, 0);
+            close(fds[i].fd);
+            std::lock_guard lock(children_mutex);
+            auto child = std::ranges::find(children, pids[i], &Child::pid);
+            child->exited = true;
+            child->status = status;
+            exited = true;
+        }
+        if (exited) {
+            SDL_Event event{};
+            event.type = exit_event;
+            SDL_PushEvent(&event);
+        }
     }
-    return true;
 }
 
-bool process_running()
+// A function to launch an external application. posix_spawn doesn't copy the launcher's
+// mappings like fork does, and it reports exec failures directly instead of through the exit status
+bool start_process(const BL::Command &command, bool application)
 {
-    pid_t pid = waitpid(-1*child_pid, nullptr, WNOHANG);
-    if (pid > 0) {
-        if (waitpid(-1*child_pid, nullptr, WNOHANG) == -1)
+    std::string shell_line;
+    std::vector<char*> argv;
+    if (command.needs_shell()) {
+        shell_line = command.get_process_line();
+        if (shell_line.empty()) {
+            BL::logger::error("Command '{}' has nothing to run", command.get_line());
             return false;
-    } 
-    else if (pid == -1)
+        }
+        argv = {const_cast<char*>("sh"), const_cast<char*>("-c"), shell_line.data()};
+    }
+    else {
+        for (const std::string &arg : command.get_args())
+            argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    // The child starts in its own process group with no signals blocked
+    posix_spawnattr_t attr;
+    sigset_t signals;
+    posix_spawnattr_init(&attr);
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    pid_t pid;
+    const char *file = command.needs_shell() ? "/bin/sh" : argv[0];
+    int error = posix_spawnp(&pid, file, nullptr, &attr, argv.data(), environ);
+    posix_spawnattr_destroy(&attr);
+    if (error) {
+        BL::logger::error("Could not run '{}': {}", file, std::strerror(error));
         return false;
+    }
+
+    int pidfd = open_pidfd(pid);
+    if (pidfd != -1 && !supervisor.start()) {
+        close(pidfd);
+        pidfd = -1;
+    }
+    {
+        std::lock_guard lock(children_mutex);
+        children.push_back({pid, pidfd, command.needs_shell()});
+    }
+    if (pidfd != -1)
+        supervisor.wake();
+    if (application)
+        application_pid = pid;
     return true;
 }
+
+// Collects the children that have exited. Returns true once the application started last has ended,
+// which is when it has exited and nothing else is left in its process group
+bool supervise_processes()
+{
+    bool application_ended = false;
+    std::lock_guard lock(children_mutex);
+    std::erase_if(children, [&application_ended](Child &child) {
+        if (!child.exited) {
+            if (child.pidfd != -1)
+                return false;
+            pid_t pid = waitpid(child.pid, &child.status, WNOHANG);
+            if (!pid)
+                return false;
+            if (pid == -1)
+                return true;
+        }
+
+        int status = child.status;
+        if (child.shell && WIFEXITED(status) && (WEXITSTATUS(status) == 126 || WEXITSTATUS(status) == 127))
+            BL::logger::error("Process {} could not be run (exit status {})", child.pid, WEXITSTATUS(status));
+        else if (WIFEXITED(status))
+            BL::logger::debug("Process {} exited with status {}", child.pid, WEXITSTATUS(status));
+        else if (WIFSIGNALED(status))
+            BL::logger::debug("Process {} was terminated by signal {}", child.pid, WTERMSIG(status));
+
+        // Wrapper scripts exit while the program they started keeps running
+        if (child.pid == application_pid) {
+            application_pid = -1;
+            if (kill(-child.pid, 0) == -1 && errno == ESRCH)
+                application_ended = true;
+            else
+                BL::logger::debug("Process group {} is still running", child.pid);
+        }
+        return true;
+    });
+    return application_ended;
+}
+
+// True if there are children without a pidfd, the event loop then has to check on them periodically
+bool processes_need_polling()
+{
+    std::lock_guard lock(children_mutex);
+    return std::ranges::any_of(children, [](const Child &child) { return child.pidfd == -1; });
+}
+
+bool process_running()
+{
+    return application_pid != -1;
+}
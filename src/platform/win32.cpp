@@ -59,14 +59,14 @@ static void parse_command(const std::string &command, std::string &file, std::st
 }
 
 // A function to launch an application
-bool start_process(const std::string &command, bool application)
+bool start_process(const BL::Command &command, bool application)
 {
     bool ret = false;
     std::string file;
     std::string params;
     
     // Parse command into file and parameters strings
-    parse_command(command, file, params);
+    parse_command(std::string(command.get_process_line()), file, params);
 
     // Set up info struct
     SHELLEXECUTEINFOA info = {
@@ -107,6 +107,19 @@ bool process_running()
     return status == WAIT_OBJECT_0 ? false : true;
 }
 
+// ShellExecuteEx doesn't leave anything behind to reap. The launched process exiting says nothing about
+// the game, stubs like Steam or Epic hand it to a client that is already running and exit right away,
+// so the return to the launcher is only detected through the focus event
+bool supervise_processes()
+{
+    return false;
+}
+
+bool processes_need_polling()
+{
+    return false;
+}
+
 void set_foreground_window()
 {
     SetForegroundWindow(hwnd);
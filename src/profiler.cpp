@@ -0,0 +1,148 @@
+#include <string>
+#include <fstream>
+#include <fmt/core.h>
+#include "logger.hpp"
+#include <lconfig.h>
+#include "profiler.hpp"
+
+extern BL::Profiler profiler;
+
+namespace BL {
+    // Per thread byte counters, so concurrent entries are only charged for their own work
+    thread_local size_t decoded_counter = 0;
+    thread_local size_t uploaded_counter = 0;
+
+    std::string json_string(const std::string &string)
+    {
+        std::string out = "\"";
+        for (char c : string) {
+            if (c == '"' || c == '\\')
+                out += fmt::format("\\{}", c);
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out += fmt::format("\\u{:04x}", static_cast<int>(c));
+            else
+                out += c;
+        }
+        out += '"';
+        return out;
+    }
+}
+
+void BL::Profiler::add_phase(const char *name, Clock::time_point begin, Clock::time_point end)
+{
+    std::lock_guard lock(mutex);
+    phases.push_back({name, elapsed(begin), std::chrono::duration<double, std::milli>(end - begin).count()});
+}
+
+void BL::Profiler::add_entry(const std::string &title, const std::string &menu, const char *stage, Clock::time_point begin, Clock::time_point end, size_t decoded, size_t uploaded)
+{
+    std::lock_guard lock(mutex);
+    entries.push_back({title, menu, stage, elapsed(begin), std::chrono::duration<double, std::milli>(end - begin).count(), decoded, uploaded});
+}
+
+void BL::Profiler::add_decoded(size_t bytes)
+{
+    if (!enabled)
+        return;
+    bytes_decoded += bytes;
+    BL::decoded_counter += bytes;
+}
+
+void BL::Profiler::add_uploaded(size_t bytes)
+{
+    if (!enabled)
+        return;
+    bytes_uploaded += bytes;
+    BL::uploaded_counter += bytes;
+}
+
+size_t BL::Profiler::thread_decoded()
+{
+    return BL::decoded_counter;
+}
+
+size_t BL::Profiler::thread_uploaded()
+{
+    return BL::uploaded_counter;
+}
+
+void BL::Profiler::write()
+{
+    if (!enabled || written)
+        return;
+    written = true;
+
+    std::lock_guard lock(mutex);
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        BL::logger::error("Could not write startup profile '{}'", path);
+        return;
+    }
+    file << "{\n";
+    file << fmt::format("  \"version\": {},\n", BL::json_string(PROJECT_VERSION));
+    file << fmt::format("  \"total_ms\": {:.3f},\n", elapsed(Clock::now()));
+    file << fmt::format("  \"first_frame_ms\": {:.3f},\n", first_frame);
+    file << fmt::format("  \"bytes_decoded\": {},\n", bytes_decoded.load());
+    file << fmt::format("  \"bytes_uploaded\": {},\n", bytes_uploaded.load());
+    file << "  \"phases\": [";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const Phase &phase = phases[i];
+        file << fmt::format("{}\n    {{\"name\": {}, \"start_ms\": {:.3f}, \"duration_ms\": {:.3f}}}",
+                    i ? "," : "",
+                    BL::json_string(phase.name),
+                    phase.start,
+                    phase.duration
+                );
+    }
+    file << "\n  ],\n";
+    file << "  \"entries\": [";
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry &entry = entries[i];
+        file << fmt::format("{}\n    {{\"title\": {}, \"menu\": {}, \"stage\": {}, \"start_ms\": {:.3f}, \"duration_ms\": {:.3f}, \"bytes_decoded\": {}, \"bytes_uploaded\": {}}}",
+                    i ? "," : "",
+                    BL::json_string(entry.title),
+                    BL::json_string(entry.menu),
+                    BL::json_string(entry.stage),
+                    entry.start,
+                    entry.duration,
+                    entry.bytes_decoded,
+                    entry.bytes_uploaded
+                );
+    }
+    file << "\n  ]\n}\n";
+    BL::logger::debug("Wrote startup profile to '{}'", path);
+}
+
+BL::ProfileScope::ProfileScope(const char *name):
+    name(name),
+    begin(profiler.is_enabled() ? Profiler::Clock::now() : Profiler::Clock::time_point())
+{}
+
+BL::ProfileScope::~ProfileScope()
+{
+    if (profiler.is_enabled())
+        profiler.add_phase(name, begin, Profiler::Clock::now());
+}
+
+BL::EntryProfileScope::EntryProfileScope(const std::string &title, const std::string &menu, const char *stage):
+    title(title),
+    menu(menu),
+    stage(stage),
+    begin(profiler.is_enabled() ? Profiler::Clock::now() : Profiler::Clock::time_point()),
+    decoded(Profiler::thread_decoded()),
+    uploaded(Profiler::thread_uploaded())
+{}
+
+BL::EntryProfileScope::~EntryProfileScope()
+{
+    if (profiler.is_enabled()) {
+        profiler.add_entry(title, 
+            menu, 
+            stage, 
+            begin, 
+            Profiler::Clock::now(), 
+            Profiler::thread_decoded() - decoded, 
+            Profiler::thread_uploaded() - uploaded
+        );
+    }
+}
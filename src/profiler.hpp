@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace BL {
+    // Collects startup timings for --profile-startup and writes them as a JSON report.
+    // Recording is a no-op unless enabled
+    class Profiler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        struct Phase {
+            std::string name;
+            double start;
+            double duration;
+        };
+        struct Entry {
+            std::string title;
+            std::string menu;
+            const char *stage;
+            double start;
+            double duration;
+            size_t bytes_decoded;
+            size_t bytes_uploaded;
+        };
+
+        bool enabled = false;
+        bool written = false;
+        std::string path;
+        Clock::time_point start = Clock::now();
+        std::mutex mutex;
+        std::vector<Phase> phases;
+        std::vector<Entry> entries;
+        std::atomic<size_t> bytes_decoded = 0;
+        std::atomic<size_t> bytes_uploaded = 0;
+        double first_frame = 0.0;
+
+    public:
+        Profiler() = default;
+        ~Profiler() = default;
+
+        void enable(const std::string &path) { this->path = path; enabled = true; }
+        bool is_enabled() const { return enabled; }
+        double elapsed(Clock::time_point t) const { return std::chrono::duration<double, std::milli>(t - start).count(); }
+        void add_phase(const char *name, Clock::time_point begin, Clock::time_point end);
+        void add_entry(const std::string &title, const std::string &menu, const char *stage, Clock::time_point begin, Clock::time_point end, size_t decoded, size_t uploaded);
+        void add_decoded(size_t bytes);
+        void add_uploaded(size_t bytes);
+        void set_first_frame() { first_frame = elapsed(Clock::now()); }
+        void write();
+
+        static size_t thread_decoded();
+        static size_t thread_uploaded();
+    };
+
+    // Times the enclosing scope as a startup phase
+    class ProfileScope {
+    private:
+        const char *name;
+        Profiler::Clock::time_point begin;
+
+    public:
+        ProfileScope(const char *name);
+        ~ProfileScope();
+    };
+
+    // Times the enclosing scope as a stage of a single menu entry, including the bytes it decoded and uploaded
+    class EntryProfileScope {
+    private:
+        const std::string &title;
+        const std::string &menu;
+        const char *stage;
+        Profiler::Clock::time_point begin;
+        size_t decoded;
+        size_t uploaded;
+
+    public:
+        EntryProfileScope(const std::string &title, const std::string &menu, const char *stage);
+        ~EntryProfileScope();
+    };
+}
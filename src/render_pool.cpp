@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "logger.hpp"
+#include "render_pool.hpp"
+#include "image.hpp"
+
+BL::RenderPool::RenderPool(int num_threads)
+{
+    num_threads = std::max(num_threads, 1);
+
+    // Rasterizers are created up front, so a failure is raised on the calling thread
+    rasterizers.reserve(num_threads);
+    for (int i = 0; i < num_threads; i++)
+        rasterizers.push_back(std::make_unique<BL::SVGRasterizer>());
+    threads.reserve(num_threads);
+    for (auto &rasterizer : rasterizers)
+        threads.emplace_back(&BL::RenderPool::worker, this, std::ref(*rasterizer));
+    BL::logger::debug("Started render pool with {} threads", num_threads);
+}
+
+BL::RenderPool::~RenderPool()
+{
+    // Jobs that haven't started yet are dropped
+    {
+        std::unique_lock lock(mutex);
+        stop = true;
+        pending -= static_cast<int>(jobs.size());
+        jobs.clear();
+    }
+    job_available.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void BL::RenderPool::submit(Job &&job)
+{
+    {
+        std::unique_lock lock(mutex);
+        jobs.push_back(std::move(job));
+        pending++;
+    }
+    job_available.notify_one();
+}
+
+// Blocks until every submitted job has finished
+void BL::RenderPool::wait()
+{
+    std::unique_lock lock(mutex);
+    jobs_done.wait(lock, [this]{ return !pending; });
+}
+
+void BL::RenderPool::worker(BL::SVGRasterizer &rasterizer)
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            job_available.wait(lock, [this]{ return stop || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job(rasterizer);
+        bool done;
+        {
+            std::unique_lock lock(mutex);
+            done = !--pending;
+        }
+        if (done)
+            jobs_done.notify_all();
+    }
+}
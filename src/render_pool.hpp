@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace BL {
+    class SVGRasterizer;
+
+    // Fixed set of worker threads for surface rendering. NSVGrasterizer isn't thread-safe,
+    // so each worker owns its own SVGRasterizer and hands it to the jobs it runs
+    class RenderPool {
+    public:
+        using Job = std::function<void(SVGRasterizer&)>;
+
+    private:
+        std::vector<std::unique_ptr<SVGRasterizer>> rasterizers;
+        std::vector<std::thread> threads;
+        std::deque<Job> jobs;
+        std::mutex mutex;
+        std::condition_variable job_available;
+        std::condition_variable jobs_done;
+        int pending = 0;
+        bool stop = false;
+
+        void worker(SVGRasterizer &rasterizer);
+
+    public:
+        RenderPool(int num_threads);
+        ~RenderPool();
+
+        int num_threads() const { return static_cast<int>(threads.size()); }
+        void submit(Job &&job);
+        void wait();
+    };
+}
@@ -9,13 +9,16 @@ namespace BL {
         bool update_tx_coords = true;
         SDL_FRect pos{};
         SDL_FRect tex_coords{};
+        SDL_Color color_mod{0xFF, 0xFF, 0xFF, 0xFF};
 
     public:
         Texture() = default;
         Texture(float w, float h): pos({0.f, 0.f, w, h}), tex_coords(0.f, 0.f, w, h) {}
+        Texture(const SDL_FRect &tex_coords): pos({0.f, 0.f, tex_coords.w, tex_coords.h}), tex_coords(tex_coords) {}
         virtual ~Texture() = default;
 
-        virtual void set_color_mod(const SDL_Color &color) = 0;
+        void set_color_mod(const SDL_Color &color) { color_mod = color; }
+        const SDL_Color& get_color_mod() const { return color_mod; }
         void set_x(float x) { pos.x = x; update_buffer = true; }
         void set_y(float y) { pos.y = y; update_buffer = true; }
         void set_w(float w) { pos.w = w; update_buffer = true; }
@@ -35,22 +38,32 @@ namespace BL {
         SDL_Window &window;
 
     protected:
+        SDL_FPoint translation{}; // added to the position of every drawn texture
         Renderer(SDL_Window &window): window(window) {}
 
     public:
         virtual ~Renderer() = default;
 
+        void set_translation(float x, float y) { translation = {x, y}; }
+
         virtual void set_draw_color(const SDL_Color &color) = 0;
         virtual void clear() = 0;
         virtual void present() = 0;
         virtual void set_clip_rect(SDL_Rect &rect) = 0;
         virtual void disable_clip() = 0;
         virtual void draw(Texture &texture) = 0;
+        virtual void fill_rects(const SDL_FRect *rects, int count, const SDL_Color &color) = 0;
+        virtual void flush() = 0;
 
         virtual Texture* create_texture(SDL_Surface &surface) = 0;
+        virtual Texture* create_atlas_texture(SDL_Surface &surface) = 0;
         virtual Texture* create_texture(SDL_Surface &surface, int w, int h) = 0;
         virtual Texture* create_texture(int w, int h) = 0;
         virtual void composit_texture(const Texture &src, const Texture &dst, SDL_FRect *coords) = 0;
+        virtual Texture* create_layer(int w, int h) = 0;
+        virtual void begin_layer(Texture &layer) = 0;
+        virtual void end_layer() = 0;
+        virtual int get_max_layer_size() const = 0;
         virtual void set_render_scale(float scale_w, float scale_h) {}
         virtual void set_logical_representation(int w, int h) {}
 
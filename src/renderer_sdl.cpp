@@ -1,12 +1,87 @@
+#include <algorithm>
+#include <vector>
 #include "renderer_sdl.hpp"
 #include "logger.hpp"
+#include "profiler.hpp"
+#include "frame_stats.hpp"
 
-void BL::TextureSDL::set_color_mod(const SDL_Color &color)
+extern BL::Profiler profiler;
+extern BL::FrameStats frame_stats;
+
+namespace BL {
+    constexpr int MAX_ATLAS_SIZE = 4096;
+    constexpr int ATLAS_PADDING = 1;
+    constexpr size_t BATCH_RESERVE = 256; // quads
+}
+
+// Slots of the exact size that were released are recycled first, otherwise
+// the slot is placed on the best fitting shelf, or on a new shelf
+bool BL::AtlasPage::allocate(int w, int h, SDL_Rect &rect)
 {
-    SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
-    SDL_SetTextureAlphaMod(texture, color.a);
+    auto it = std::find_if(free_slots.begin(), free_slots.end(), [=](const SDL_Rect &r){ return r.w == w && r.h == h; });
+    if (it != free_slots.end()) {
+        rect = *it;
+        free_slots.erase(it);
+        live_slots++;
+        return true;
+    }
+
+    int slot_w = w + BL::ATLAS_PADDING;
+    int slot_h = h + BL::ATLAS_PADDING;
+    Shelf *best = nullptr;
+    for (Shelf &shelf : shelves) {
+        if (shelf.h >= slot_h && shelf.x + slot_w <= texture->w && (!best || shelf.h < best->h))
+            best = &shelf;
+    }
+    if (!best) {
+        int y = shelves.empty() ? 0 : shelves.back().y + shelves.back().h;
+        if (y + slot_h > texture->h || slot_w > texture->w)
+            return false;
+        best = &shelves.emplace_back(y, slot_h, 0);
+    }
+    rect = {best->x, best->y, w, h};
+    best->x += slot_w;
+    live_slots++;
+    return true;
 }
 
+void BL::AtlasPage::release(const SDL_Rect &rect)
+{
+    free_slots.push_back(rect);
+    live_slots--;
+}
+
+BL::TextureSDL::TextureSDL(SDL_Texture *texture):
+    Texture(texture->w, texture->h),
+    texture(texture)
+{
+    frame_stats.add_texture();
+}
+
+BL::TextureSDL::TextureSDL(BL::RendererSDL &renderer, BL::AtlasPage &page, const SDL_Rect &rect):
+    Texture({static_cast<float>(rect.x), static_cast<float>(rect.y), static_cast<float>(rect.w), static_cast<float>(rect.h)}),
+    texture(page.get_texture()),
+    renderer(&renderer),
+    page(&page)
+{
+    frame_stats.add_texture();
+}
+
+BL::TextureSDL::~TextureSDL()
+{
+    frame_stats.remove_texture();
+    if (page) {
+        SDL_Rect rect = {
+            static_cast<int>(tex_coords.x),
+            static_cast<int>(tex_coords.y),
+            static_cast<int>(tex_coords.w),
+            static_cast<int>(tex_coords.h)
+        };
+        renderer->release_atlas_slot(*page, rect);
+    }
+    else
+        SDL_DestroyTexture(texture);
+}
 
 BL::RendererSDL::RendererSDL(SDL_Window &window):
     Renderer(window),
@@ -24,12 +99,21 @@ BL::RendererSDL::RendererSDL(SDL_Window &window):
     }
     if (formats[i] == SDL_PIXELFORMAT_UNKNOWN)
         BL::logger::critical("GPU does not support the required pixel format");
+    atlas_size = std::min(BL::MAX_ATLAS_SIZE, static_cast<int>(SDL_GetNumberProperty(props, SDL_PROP_RENDERER_MAX_TEXTURE_SIZE_NUMBER, BL::MAX_ATLAS_SIZE)));
+    vertices.reserve(4 * BL::BATCH_RESERVE);
+    indices.reserve(6 * BL::BATCH_RESERVE);
 
     SDL_SetRenderVSync(renderer, 1);
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
 }
 
+BL::RendererSDL::~RendererSDL()
+{
+    atlas_pages.clear();
+    SDL_DestroyRenderer(renderer);
+}
+
 void BL::RendererSDL::set_draw_color(const SDL_Color &color)
 {
     SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
@@ -37,26 +121,33 @@ void BL::RendererSDL::set_draw_color(const SDL_Color &color)
 
 void BL::RendererSDL::clear()
 {
+    flush();
     SDL_RenderClear(renderer);
 }
 
 void BL::RendererSDL::present()
 {
+    flush();
     SDL_RenderPresent(renderer);
 }
 
 BL::Texture* BL::RendererSDL::create_texture(SDL_Surface &surface)
 {
+    profiler.add_uploaded(static_cast<size_t>(surface.w) * surface.h * 4);
     return new BL::TextureSDL(SDL_CreateTextureFromSurface(renderer, &surface));
 }
 
 BL::Texture* BL::RendererSDL::create_texture(SDL_Surface &surface, int w, int h)
 {
+    flush();
+    profiler.add_uploaded(static_cast<size_t>(surface.w) * surface.h * 4);
     SDL_Texture *src_texture = SDL_CreateTextureFromSurface(renderer, &surface);
     SDL_Texture *dst_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
     SDL_SetTextureBlendMode(dst_texture, SDL_BLENDMODE_BLEND);
     SDL_SetRenderTarget(renderer, dst_texture);
     SDL_RenderTexture(renderer, src_texture, nullptr, nullptr);
+    frame_stats.add_draw_call();
+    SDL_SetRenderTarget(renderer, nullptr);
     SDL_DestroyTexture(src_texture);
     return new BL::TextureSDL(dst_texture);
 }
@@ -67,40 +158,193 @@ BL::Texture* BL::RendererSDL::create_texture(int w, int h)
     return new BL::TextureSDL(texture);
 }
 
+BL::AtlasPage* BL::RendererSDL::create_atlas_page()
+{
+    // Static pages survive render target resets, unlike target textures
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, atlas_size, atlas_size);
+    if (!texture) {
+        BL::logger::error("Could not create texture atlas (SDL Error: {})", SDL_GetError());
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    // Clear to transparent, so the padding between slots doesn't bleed into neighbouring textures
+    std::vector<Uint8> zeros(static_cast<size_t>(atlas_size) * atlas_size * 4);
+    SDL_UpdateTexture(texture, nullptr, zeros.data(), atlas_size * 4);
+
+    BL::logger::debug("Created {}x{} texture atlas page", atlas_size, atlas_size);
+    return atlas_pages.emplace_back(std::make_unique<BL::AtlasPage>(texture)).get();
+}
+
+BL::Texture* BL::RendererSDL::create_atlas_texture(SDL_Surface &surface)
+{
+    if (surface.w + BL::ATLAS_PADDING > atlas_size || surface.h + BL::ATLAS_PADDING > atlas_size)
+        return create_texture(surface);
+
+    SDL_Rect rect;
+    BL::AtlasPage *page = nullptr;
+    for (auto &p : atlas_pages) {
+        if (p->allocate(surface.w, surface.h, rect)) {
+            page = p.get();
+            break;
+        }
+    }
+    if (!page) {
+        page = create_atlas_page();
+        if (!page || !page->allocate(surface.w, surface.h, rect))
+            return create_texture(surface);
+    }
 
+    if (page->get_texture() == batch_texture)
+        flush();
+    SDL_Surface *converted = surface.format == SDL_PIXELFORMAT_RGBA32 ? &surface : SDL_ConvertSurface(&surface, SDL_PIXELFORMAT_RGBA32);
+    SDL_UpdateTexture(page->get_texture(), &rect, converted->pixels, converted->pitch);
+    profiler.add_uploaded(static_cast<size_t>(surface.w) * surface.h * 4);
+    if (converted != &surface)
+        SDL_DestroySurface(converted);
+    return new BL::TextureSDL(*this, *page, rect);
+}
+
+void BL::RendererSDL::release_atlas_slot(BL::AtlasPage &page, const SDL_Rect &rect)
+{
+    page.release(rect);
+    if (page.empty()) {
+        if (page.get_texture() == batch_texture)
+            flush();
+        std::erase_if(atlas_pages, [&](const auto &p){ return p.get() == &page; });
+    }
+}
+
+// Queues a textured quad at its position plus the translation,
+// consecutive quads from the same texture (atlas page) are submitted together
 void BL::RendererSDL::draw(Texture &texture)
 {
-    SDL_SetRenderTarget(renderer, nullptr);
-    SDL_RenderTexture(renderer,
-        const_cast<SDL_Texture*>(static_cast<BL::TextureSDL&>(texture).get_texture()),
-        &texture.get_tex_coords(),
-        &texture.get_pos()
-    );
+    SDL_Texture *sdl_texture = static_cast<BL::TextureSDL&>(texture).get_texture();
+    if (sdl_texture != batch_texture) {
+        flush();
+        batch_texture = sdl_texture;
+    }
+
+    SDL_FRect pos = texture.get_pos();
+    pos.x += translation.x;
+    pos.y += translation.y;
+    const SDL_FRect &tex_coords = texture.get_tex_coords();
+    const SDL_Color &color_mod = texture.get_color_mod();
+    float tex_w = static_cast<float>(sdl_texture->w);
+    float tex_h = static_cast<float>(sdl_texture->h);
+    float u0 = tex_coords.x / tex_w;
+    float v0 = tex_coords.y / tex_h;
+    float u1 = (tex_coords.x + tex_coords.w) / tex_w;
+    float v1 = (tex_coords.y + tex_coords.h) / tex_h;
+    SDL_FColor color = {
+        static_cast<float>(color_mod.r) / 255.f,
+        static_cast<float>(color_mod.g) / 255.f,
+        static_cast<float>(color_mod.b) / 255.f,
+        static_cast<float>(color_mod.a) / 255.f
+    };
+
+    int i = static_cast<int>(vertices.size());
+    vertices.push_back({{pos.x, pos.y}, color, {u0, v0}});
+    vertices.push_back({{pos.x + pos.w, pos.y}, color, {u1, v0}});
+    vertices.push_back({{pos.x + pos.w, pos.y + pos.h}, color, {u1, v1}});
+    vertices.push_back({{pos.x, pos.y + pos.h}, color, {u0, v1}});
+    for (int index : {i, i + 1, i + 2, i, i + 2, i + 3})
+        indices.push_back(index);
+}
+
+void BL::RendererSDL::flush()
+{
+    if (!vertices.empty()) {
+        SDL_RenderGeometry(renderer, 
+            batch_texture, 
+            vertices.data(), 
+            static_cast<int>(vertices.size()), 
+            indices.data(), 
+            static_cast<int>(indices.size())
+        );
+        frame_stats.add_draw_call();
+        vertices.clear();
+        indices.clear();
+    }
+    batch_texture = nullptr;
+}
+
+void BL::RendererSDL::fill_rects(const SDL_FRect *rects, int count, const SDL_Color &color)
+{
+    if (!count)
+        return;
+    flush();
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRects(renderer, rects, count);
+    frame_stats.add_draw_call();
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
 }
 
 void BL::RendererSDL::composit_texture(const Texture &src, const Texture &dst, SDL_FRect *coords)
 {
-    SDL_SetRenderTarget(renderer, const_cast<SDL_Texture*>(static_cast<const BL::TextureSDL&>(dst).get_texture()));
-    SDL_RenderTexture(renderer, const_cast<SDL_Texture*>(static_cast<const BL::TextureSDL&>(src).get_texture()), nullptr, coords);
+    flush();
+    SDL_SetRenderTarget(renderer, static_cast<const BL::TextureSDL&>(dst).get_texture());
+    SDL_RenderTexture(renderer, static_cast<const BL::TextureSDL&>(src).get_texture(), nullptr, coords);
+    frame_stats.add_draw_call();
+    SDL_SetRenderTarget(renderer, nullptr);
+}
+
+// Layers are render targets that cached draws are composed into. Blending onto a transparent target
+// leaves premultiplied colours behind, so the layer itself is drawn with premultiplied blending
+BL::Texture* BL::RendererSDL::create_layer(int w, int h)
+{
+    if (w > atlas_size || h > atlas_size)
+        return nullptr;
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!texture) {
+        BL::logger::error("Could not create {}x{} layer (SDL Error: {})", w, h, SDL_GetError());
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND_PREMULTIPLIED);
+    return new BL::TextureSDL(texture);
+}
+
+// Redirects drawing into the layer until end_layer(), the layer is cleared to transparent first
+void BL::RendererSDL::begin_layer(Texture &layer)
+{
+    flush();
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_SetRenderTarget(renderer, static_cast<BL::TextureSDL&>(layer).get_texture());
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
+
+void BL::RendererSDL::end_layer()
+{
+    flush();
     SDL_SetRenderTarget(renderer, nullptr);
 }
 
 void BL::RendererSDL::set_clip_rect(SDL_Rect &rect)
 {
+    flush();
     SDL_SetRenderClipRect(renderer, &rect);
 }
 
 void BL::RendererSDL::disable_clip()
 {
+    flush();
     SDL_SetRenderClipRect(renderer, nullptr);
 }
 
 void BL::RendererSDL::set_render_scale(float scale_w, float scale_h)
 {
+    flush();
     SDL_SetRenderScale(renderer, scale_w, scale_h);
 }
 
 void BL::RendererSDL::set_logical_representation(int w, int h)
 {
+    flush();
     SDL_SetRenderLogicalPresentation(renderer, w, h, SDL_LOGICAL_PRESENTATION_LETTERBOX);
 }
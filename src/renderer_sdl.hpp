@@ -1,36 +1,74 @@
 #pragma once
 
+#include <vector>
+#include <memory>
+
 #include <SDL3/SDL.h>
 
 #include "renderer.hpp"
 
 namespace BL {
+    class RendererSDL;
+
+    // A large texture that many small textures are packed into, so they can be drawn in a single batch
+    class AtlasPage {
+    private:
+        struct Shelf {
+            int y;
+            int h;
+            int x;
+        };
+        SDL_Texture *texture;
+        std::vector<Shelf> shelves;
+        std::vector<SDL_Rect> free_slots;
+        int live_slots = 0;
+
+    public:
+        AtlasPage(SDL_Texture *texture): texture(texture) {}
+        ~AtlasPage() { SDL_DestroyTexture(texture); }
+
+        SDL_Texture* get_texture() const { return texture; }
+        bool allocate(int w, int h, SDL_Rect &rect);
+        void release(const SDL_Rect &rect);
+        bool empty() const { return !live_slots; }
+    };
+
     class TextureSDL: public Texture {
     private:
         SDL_Texture *texture;
+        RendererSDL *renderer = nullptr; // set if the texture lives in an atlas page
+        AtlasPage *page = nullptr;
 
     public:
-        TextureSDL(SDL_Texture *texture): Texture(texture->w, texture->h), texture(texture) {}
-        ~TextureSDL() override = default;
-        const SDL_Texture* get_texture() const { return texture; }
-        void set_color_mod(const SDL_Color &color) override;
+        TextureSDL(SDL_Texture *texture);
+        TextureSDL(RendererSDL &renderer, AtlasPage &page, const SDL_Rect &rect);
+        ~TextureSDL() override;
+        SDL_Texture* get_texture() const { return texture; }
     };
 
     class RendererSDL: public Renderer {
     public:
         RendererSDL(SDL_Window &window);
-        ~RendererSDL() override = default;
+        ~RendererSDL() override;
 
         //void render(const Texture &texture) override;
         void set_draw_color(const SDL_Color &color) override;
         void clear() override;
         void present() override;
         void draw(Texture &texture) override;
+        void fill_rects(const SDL_FRect *rects, int count, const SDL_Color &color) override;
+        void flush() override;
 
         Texture* create_texture(SDL_Surface &surface) override;
         Texture* create_texture(SDL_Surface &surface, int w, int h) override;
         virtual Texture* create_texture(int w, int h) override;
+        Texture* create_atlas_texture(SDL_Surface &surface) override;
+        void release_atlas_slot(AtlasPage &page, const SDL_Rect &rect);
         void composit_texture(const Texture &src, const Texture &dst, SDL_FRect *coords) override;
+        Texture* create_layer(int w, int h) override;
+        void begin_layer(Texture &layer) override;
+        void end_layer() override;
+        int get_max_layer_size() const override { return atlas_size; }
         void set_clip_rect(SDL_Rect &rect) override;
         void disable_clip() override;
         void set_render_scale(float scale_w, float scale_h) override;
@@ -38,6 +76,14 @@ namespace BL {
 
     private:
         SDL_Renderer *renderer = nullptr;
+        int atlas_size;
+        std::vector<std::unique_ptr<AtlasPage>> atlas_pages;
+
+        // Quads are accumulated per texture and submitted with a single SDL_RenderGeometry call
+        SDL_Texture *batch_texture = nullptr;
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
 
+        AtlasPage* create_atlas_page();
     };
 }
@@ -22,7 +22,8 @@ void BL::Screensaver::render_texture()
     surface = nullptr;
 }
 
-void BL::Screensaver::update()
+// Returns true if the screensaver changed what is on screen
+bool BL::Screensaver::update()
 {
     if (!active) {
         if (launcher.time_since_last_input() > config.screensaver_idle_time) {
@@ -30,9 +31,12 @@ void BL::Screensaver::update()
             transitioning = true;
             current_ticks = launcher.current_time();
             texture->set_color_mod({0xFF, 0xFF, 0xFF, 0});
+            return true;
         }
+        return false;
     }
     else {
+        bool changed = transitioning;
         if (transitioning) {
             float delta = (static_cast<float>((launcher.current_time() - current_ticks))) * opacity_change_rate;
             opacity += delta;
@@ -46,9 +50,23 @@ void BL::Screensaver::update()
             current_ticks = launcher.current_time();
         }
         if ((launcher.time_since_last_input()) < config.screensaver_idle_time) {
-            active = false;
-            transitioning = false;
-            opacity = 0.f;
+            deactivate();
+            return true;
         }
+        return changed;
     }
 }
+
+void BL::Screensaver::deactivate()
+{
+    active = false;
+    transitioning = false;
+    opacity = 0.f;
+}
+
+// Milliseconds until the screensaver activates
+int BL::Screensaver::get_idle_timeout() const
+{
+    Uint64 idle = launcher.time_since_last_input();
+    return idle > config.screensaver_idle_time ? 0 : static_cast<int>(config.screensaver_idle_time - idle) + 1;
+}
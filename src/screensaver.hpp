@@ -28,7 +28,9 @@ namespace BL {
             ~Screensaver() = default;
             void render_surface();
             void render_texture();
-            void update();
+            bool update();
+            void deactivate();
+            int get_idle_timeout() const;
             bool is_active() const { return active; }
             bool is_transitioning() const { return transitioning; }
 
@@ -2,7 +2,7 @@
 #include "menu.hpp"
 #include "text.hpp"
 
-BL::SidebarEntry::SidebarEntry(std::string &&title, std::variant<BL::Menu*, std::string> &&value):
+BL::SidebarEntry::SidebarEntry(std::string &&title, std::variant<BL::Menu*, BL::Command> &&value):
     BL::Drawable(),
     title(title),
     value(value)
@@ -19,7 +19,7 @@ void BL::SidebarEntry::render_surface(Font &font, int max_width)
 }
 void BL::SidebarEntry::render_texture()
 {
-    texture = renderer->create_texture(*surface);
+    texture = renderer->create_atlas_texture(*surface);
 }
 void BL::SidebarEntry::set_text_color(const SDL_Color &color)
 { 
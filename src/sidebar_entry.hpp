@@ -6,6 +6,7 @@
 #include <SDL3/SDL.h>
 
 #include "drawable.hpp"
+#include "command.hpp"
 
 namespace BL {
     class Font;
@@ -13,9 +14,9 @@ namespace BL {
     class SidebarEntry: public Drawable {
     private:
         std::string title;
-        std::variant<Menu*, std::string> value;
+        std::variant<Menu*, Command> value;
     public:
-        SidebarEntry(std::string &&title, std::variant<Menu*, std::string> &&value);
+        SidebarEntry(std::string &&title, std::variant<Menu*, Command> &&value);
         ~SidebarEntry();
         void render_surface(Font &font, int max_width);
         void render_texture();
@@ -23,6 +24,6 @@ namespace BL {
         const std::string& get_title() const { return title; }
         Menu* get_menu() const { auto menu = std::get_if<Menu*>(&value); return menu ? *menu : nullptr; }
         void set_menu(Menu *menu) { value = menu; }
-        const std::string* get_command() const { return std::get_if<std::string>(&value); };
+        const Command* get_command() const { return std::get_if<Command>(&value); };
     };
 }
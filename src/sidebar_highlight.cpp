@@ -32,7 +32,9 @@ void BL::SidebarHighlight::render_surface(BL::SVGRasterizer &rasterizer, float w
 
 
     shadow_offset = std::round(max_blur * 2.0f);
-    surface = BL::create_shadow(highlight, box_shadows, shadow_offset);
+    BL::RoundedRect shadow_box = {highlight->w, highlight->h, static_cast<float>(cx)};
+    surface = shadow_box.has_closed_form() ? BL::create_shadow(shadow_box, box_shadows, shadow_offset)
+                                           : BL::create_shadow(highlight, box_shadows, shadow_offset);
     SDL_Rect tmp = {static_cast<int>(shadow_offset), static_cast<int>(shadow_offset), highlight->w, highlight->h};
     SDL_BlitSurface(highlight, nullptr, surface, &tmp);
     BL::free_surface(highlight);
@@ -0,0 +1,126 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <fmt/core.h>
+#include <SDL3/SDL.h>
+#include <lconfig.h>
+#include "stats_overlay.hpp"
+#include "frame_stats.hpp"
+#include "renderer.hpp"
+#include "image.hpp"
+
+extern BL::FrameStats frame_stats;
+
+namespace BL {
+    constexpr float STATS_FONT_SIZE = 0.02f;
+    constexpr float STATS_WIDTH = 0.2f;
+    constexpr float STATS_GRAPH_HEIGHT = 0.08f;
+    constexpr float STATS_MARGIN = 0.01f;
+    constexpr float STATS_GRAPH_MAX_MS = 50.f;
+    constexpr float STATS_FRAME_BUDGET_MS = 1000.f / 60.f;
+    constexpr Uint64 STATS_REFRESH_PERIOD = 250; // ms
+    constexpr SDL_Color STATS_PANEL_COLOR = {0x00, 0x00, 0x00, 0xB0};
+    constexpr SDL_Color STATS_FAST_COLOR = {0x4C, 0xAF, 0x50, 0xFF};
+    constexpr SDL_Color STATS_SLOW_COLOR = {0xF4, 0x43, 0x36, 0xFF};
+    constexpr SDL_Color STATS_BUDGET_COLOR = {0xFF, 0xFF, 0xFF, 0x60};
+}
+
+BL::StatsOverlay::StatsOverlay(BL::Renderer &renderer, int screen_w, int screen_h):
+    renderer(renderer),
+    font(SIDEBAR_FONT, static_cast<int>(std::round(static_cast<float>(screen_h) * BL::STATS_FONT_SIZE)))
+{
+    float f_screen_w = static_cast<float>(screen_w);
+    float f_screen_h = static_cast<float>(screen_h);
+    padding = std::round(f_screen_h * BL::STATS_MARGIN);
+    panel = {padding, padding, std::round(f_screen_w * BL::STATS_WIDTH), 0.f};
+    graph = {panel.x + padding, 0.f, panel.w - 2.f * padding, std::round(f_screen_h * BL::STATS_GRAPH_HEIGHT)};
+    fast_bars.reserve(BL::FrameStats::HISTORY);
+    slow_bars.reserve(BL::FrameStats::HISTORY);
+}
+
+BL::StatsOverlay::~StatsOverlay()
+{
+    delete text_texture;
+}
+
+// Renders the statistics lines into one texture, refreshed a few times per second so the numbers stay readable
+void BL::StatsOverlay::render_text()
+{
+    std::vector<std::string> lines;
+    float frame_ms = frame_stats.get_average_frame_ms();
+    lines.push_back(fmt::format("{:.1f} FPS  {:.2f} ms  (max {:.1f} ms)", frame_ms > 0.f ? 1000.f / frame_ms : 0.f, frame_ms, frame_stats.get_max_frame_ms()));
+    for (int i = 0; i < BL::FrameStats::NUM_STAGES; i++) {
+        auto stage = static_cast<BL::FrameStats::Stage>(i);
+        lines.push_back(fmt::format("{}: {:.3f} ms", BL::FrameStats::stage_name(stage), frame_stats.get_average_ms(stage)));
+    }
+    lines.push_back(fmt::format("draw calls: {}  textures: {}", frame_stats.get_draw_calls(), frame_stats.get_live_textures()));
+#ifdef COUNT_ALLOCATIONS
+    lines.push_back(fmt::format("allocations: {}  allocating frames: {}", frame_stats.get_allocations(), frame_stats.get_allocating_frames()));
+#endif
+
+    int max_width = static_cast<int>(panel.w - 2.f * padding);
+    std::vector<SDL_Surface*> surfaces;
+    int w = 0;
+    int h = 0;
+    for (const std::string &line : lines) {
+        SDL_Surface *surface = font.render_text(line, nullptr, nullptr, max_width);
+        if (!surface)
+            continue;
+        w = std::max(w, surface->w);
+        h += surface->h;
+        surfaces.push_back(surface);
+    }
+    delete text_texture;
+    text_texture = nullptr;
+    if (surfaces.empty())
+        return;
+
+    SDL_Surface *text = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+    SDL_FillSurfaceRect(text, nullptr, SDL_MapSurfaceRGBA(text, 0, 0, 0, 0));
+    SDL_Rect dst = {0, 0, 0, 0};
+    for (SDL_Surface *surface : surfaces) {
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(surface, nullptr, text, &dst);
+        dst.y += surface->h;
+        BL::free_surface(surface);
+    }
+    text_texture = renderer.create_texture(*text);
+    text_texture->set_x(panel.x + padding);
+    text_texture->set_y(panel.y + padding);
+    BL::free_surface(text);
+
+    graph.y = panel.y + 2.f * padding + static_cast<float>(h);
+    panel.h = graph.y + graph.h + padding - panel.y;
+}
+
+void BL::StatsOverlay::draw()
+{
+    Uint64 ticks = SDL_GetTicks();
+    if (!text_texture || ticks - last_refresh >= BL::STATS_REFRESH_PERIOD) {
+        render_text();
+        last_refresh = ticks;
+    }
+    if (!text_texture)
+        return;
+
+    // Frame time graph, frames over budget are drawn in red
+    fast_bars.clear();
+    slow_bars.clear();
+    float bar_w = graph.w / static_cast<float>(BL::FrameStats::HISTORY);
+    for (int i = 0; i < BL::FrameStats::HISTORY; i++) {
+        float ms = frame_stats.get_frame_ms(i);
+        float bar_h = std::round(std::min(ms / BL::STATS_GRAPH_MAX_MS, 1.f) * graph.h);
+        SDL_FRect bar = {graph.x + static_cast<float>(i) * bar_w, graph.y + graph.h - bar_h, bar_w, bar_h};
+        (ms > BL::STATS_FRAME_BUDGET_MS ? slow_bars : fast_bars).push_back(bar);
+    }
+    float budget_y = std::round(graph.y + graph.h * (1.f - BL::STATS_FRAME_BUDGET_MS / BL::STATS_GRAPH_MAX_MS));
+    SDL_FRect budget = {graph.x, budget_y, graph.w, 1.f};
+
+    renderer.disable_clip();
+    renderer.fill_rects(&panel, 1, BL::STATS_PANEL_COLOR);
+    renderer.fill_rects(fast_bars.data(), static_cast<int>(fast_bars.size()), BL::STATS_FAST_COLOR);
+    renderer.fill_rects(slow_bars.data(), static_cast<int>(slow_bars.size()), BL::STATS_SLOW_COLOR);
+    renderer.fill_rects(&budget, 1, BL::STATS_BUDGET_COLOR);
+    renderer.draw(*text_texture);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <SDL3/SDL.h>
+
+#include "text.hpp"
+
+namespace BL {
+    class Renderer;
+    class Texture;
+
+    // Frame time HUD toggled with the :stats command
+    class StatsOverlay {
+    private:
+        Renderer &renderer;
+        Font font;
+        Texture *text_texture = nullptr;
+        SDL_FRect panel;
+        SDL_FRect graph;
+        float padding;
+        Uint64 last_refresh = 0;
+        bool visible = false;
+        std::vector<SDL_FRect> fast_bars;
+        std::vector<SDL_FRect> slow_bars;
+
+        void render_text();
+
+    public:
+        StatsOverlay(Renderer &renderer, int screen_w, int screen_h);
+        ~StatsOverlay();
+
+        void toggle() { visible = !visible; last_refresh = 0; }
+        bool is_visible() const { return visible; }
+        void draw();
+    };
+}
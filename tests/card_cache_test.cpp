@@ -0,0 +1,48 @@
+#include <cstring>
+#include <vector>
+#include <fmt/core.h>
+
+#include <SDL3/SDL.h>
+
+#include "card_cache.hpp"
+#include "image.hpp"
+
+// Checks that the card cache seed only depends on the card settings, not on the padding bytes of BoxShadow
+const char *executable_dir = "";
+
+namespace {
+    BoxShadow make_shadow(int fill, float x_offset, float y_offset, float radius, Uint8 alpha)
+    {
+        BoxShadow bs;
+        std::memset(&bs, fill, sizeof(bs));
+        bs.x_offset = x_offset;
+        bs.y_offset = y_offset;
+        bs.radius = radius;
+        bs.alpha = alpha;
+        return bs;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+    auto check = [&failures](bool condition, const char *message) {
+        if (!condition) {
+            fmt::print(stderr, "FAILED: {}\n", message);
+            failures++;
+        }
+    };
+
+    std::vector<BoxShadow> zeroed = {make_shadow(0x00, 0.f, 3.5f, 12.f, 77), make_shadow(0x00, 1.f, 6.f, 20.f, 34)};
+    std::vector<BoxShadow> filled = {make_shadow(0xff, 0.f, 3.5f, 12.f, 77), make_shadow(0xff, 1.f, 6.f, 20.f, 34)};
+    Uint64 seed = BL::CardCache::make_seed(zeroed, 10.f, 300.f, 200.f);
+    check(seed == BL::CardCache::make_seed(filled, 10.f, 300.f, 200.f), "equal shadows with different padding give equal seeds");
+    check(seed == BL::CardCache::make_seed(zeroed, 10.f, 300.f, 200.f), "the seed is deterministic");
+
+    std::vector<BoxShadow> changed = {make_shadow(0x00, 0.f, 3.5f, 12.f, 78), make_shadow(0x00, 1.f, 6.f, 20.f, 34)};
+    check(seed != BL::CardCache::make_seed(changed, 10.f, 300.f, 200.f), "a different shadow alpha changes the seed");
+    check(seed != BL::CardCache::make_seed(zeroed, 11.f, 300.f, 200.f), "a different shadow offset changes the seed");
+    check(seed != BL::CardCache::make_seed(zeroed, 10.f, 301.f, 200.f), "a different card width changes the seed");
+    check(seed != BL::CardCache::make_seed({}, 10.f, 300.f, 200.f), "removing the shadows changes the seed");
+    return failures ? 1 : 0;
+}